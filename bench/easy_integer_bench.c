@@ -0,0 +1,156 @@
+/* Benchmark the EasyInteger multiplication tiers to find their crossovers.
+ *
+ * For each operand length (in limbs), we time:
+ *  - schoolbook: schoolbook multiplication only.
+ *  - karatsuba: one level of Karatsuba over schoolbook.
+ *  - kara_tuned: Karatsuba down to the current Karatsuba threshold.
+ *  - toom3: one level of Toom-3 over the tuned Karatsuba.
+ *  - toom3_tuned: Toom-3 down to the current Toom-3 threshold.
+ *  - ntt: the three-prime number theoretic transform.
+ * Each tier should take over where it beats the tuned tiers below it. We skip
+ * (and print a dash for) the slower tiers on the larger operands.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "easy_common.h"
+#include "easy_integer.h"
+
+/* Each limb holds log10(2^64) ~ 19.2659 digits; we round down so that the
+ * random integers have exactly the requested number of limbs */
+#define DIGITS_PER_LIMB 19.2659
+#define MIN_SECONDS     0.01
+#define NUM_TRIALS      5
+/* The longest operands on which we time the quadratic tiers */
+#define MAX_SCHOOLBOOK_LIMBS 4096
+#define MAX_KARATSUBA_LIMBS  8192
+#define NEVER                SIZE_MAX
+
+static struct EasyInteger
+new_random_integer(size_t const num_limbs)
+{
+    size_t const num_digits = (size_t)((double)num_limbs * DIGITS_PER_LIMB);
+    char *str = EASY_MALLOC(num_digits + 1, sizeof(*str));
+    str[0] = '1' + rand() % 9;
+    for (size_t i = 1; i < num_digits; ++i) {
+        str[i] = '0' + rand() % 10;
+    }
+    str[num_digits] = '\0';
+    struct EasyInteger me = EasyInteger__from_cstr(str);
+    EASY_FREE(str);
+    return me;
+}
+
+/// @brief  Time a multiplication with the given thresholds, in microseconds.
+///         We take the best of several trials to filter out noise.
+static double
+time_multiply(struct EasyInteger const *const a,
+              struct EasyInteger const *const b,
+              size_t const karatsuba_threshold,
+              size_t const toom3_threshold,
+              size_t const ntt_threshold)
+{
+    EasyInteger__karatsuba_threshold = karatsuba_threshold;
+    EasyInteger__toom3_threshold = toom3_threshold;
+    EasyInteger__ntt_threshold = ntt_threshold;
+    double best = 0.0;
+    for (size_t i = 0; i < NUM_TRIALS; ++i) {
+        size_t iterations = 0;
+        clock_t const start = clock();
+        clock_t end = start;
+        do {
+            struct EasyInteger c = EasyInteger__multiply(a, b);
+            EasyInteger__destroy(&c);
+            ++iterations;
+            end = clock();
+        } while ((double)(end - start) / CLOCKS_PER_SEC < MIN_SECONDS);
+        double const usec =
+            1e6 * (double)(end - start) / CLOCKS_PER_SEC / (double)iterations;
+        best = i == 0 ? usec : MIN(best, usec);
+    }
+    return best;
+}
+
+static void
+print_time(double const usec)
+{
+    if (usec < 0.0) {
+        printf(" %12s", "-");
+    } else {
+        printf(" %12.2f", usec);
+    }
+}
+
+int
+main(void)
+{
+    size_t const lengths[] = {8,    16,   32,   48,   64,   96,   128,
+                              192,  256,  384,  512,  768,  1024, 2048,
+                              4096, 8192, 16384, 32768};
+    size_t const k = EasyInteger__karatsuba_threshold;
+    size_t const t = EasyInteger__toom3_threshold;
+    size_t karatsuba_crossover = 0, toom3_crossover = 0, ntt_crossover = 0;
+
+    srand(42);
+    printf("%8s %12s %12s %12s %12s %12s %12s\n",
+           "limbs",
+           "schoolbook",
+           "karatsuba",
+           "kara_tuned",
+           "toom3",
+           "toom3_tuned",
+           "ntt");
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(*lengths); ++i) {
+        size_t const n = lengths[i];
+        bool const quadratic = n <= MAX_SCHOOLBOOK_LIMBS;
+        bool const subquadratic = n <= MAX_KARATSUBA_LIMBS;
+        struct EasyInteger a = new_random_integer(n);
+        struct EasyInteger b = new_random_integer(n);
+        double const schoolbook =
+            quadratic ? time_multiply(&a, &b, NEVER, NEVER, NEVER) : -1.0;
+        double const karatsuba =
+            quadratic ? time_multiply(&a, &b, n, NEVER, NEVER) : -1.0;
+        double const kara_tuned =
+            subquadratic ? time_multiply(&a, &b, k, NEVER, NEVER) : -1.0;
+        double const toom3 =
+            subquadratic ? time_multiply(&a, &b, k, n, NEVER) : -1.0;
+        double const toom3_tuned = time_multiply(&a, &b, k, t, NEVER);
+        double const ntt = time_multiply(&a, &b, k, t, n);
+        printf("%8zu", n);
+        print_time(schoolbook);
+        print_time(karatsuba);
+        print_time(kara_tuned);
+        print_time(toom3);
+        print_time(toom3_tuned);
+        print_time(ntt);
+        printf("\n");
+
+        /* Below the Karatsuba threshold, the tuned tiers all use schoolbook */
+        if (karatsuba_crossover == 0 && quadratic && karatsuba < schoolbook) {
+            karatsuba_crossover = n;
+        }
+        if (toom3_crossover == 0 && subquadratic && n >= k &&
+            toom3 < kara_tuned) {
+            toom3_crossover = n;
+        }
+        if (ntt_crossover == 0 && n >= k && ntt < toom3_tuned) {
+            ntt_crossover = n;
+        }
+        EasyInteger__destroy(&a);
+        EasyInteger__destroy(&b);
+    }
+    printf("Karatsuba first wins at %zu limbs (threshold: %zu)\n",
+           karatsuba_crossover,
+           k);
+    printf("Toom-3 first wins at %zu limbs (threshold: %zu)\n",
+           toom3_crossover,
+           t);
+    printf("NTT first wins at %zu limbs (threshold: %d)\n",
+           ntt_crossover,
+           EASY_INTEGER_NTT_THRESHOLD);
+    return 0;
+}
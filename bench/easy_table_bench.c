@@ -0,0 +1,301 @@
+/* Benchmark the EasyTable lookup latency for text and list keys.
+ *
+ * For each key type and table size, we time:
+ *  - hit (fresh): look up keys that we rebuilt from scratch, so a matching
+ *    hash must be confirmed with a deep comparison.
+ *  - hit (copy): look up copies of the inserted keys, which share their
+ *    buffers with the stored keys and so compare equal by identity.
+ *  - miss: look up absent keys. The stored hash rejects every item we probe.
+ *  - deep equal: compare two equal (but separately built) keys. This is what
+ *    each probed item would cost if we did not compare the hashes first.
+ *
+ * We then churn a table (removing the oldest keys and inserting new ones) and
+ * delete most of its keys, tracking the shape of the trie. Its size and depth
+ * should stay the same as a table that we built from the live keys alone.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "easy_common.h"
+#include "easy_equal.h"
+#include "easy_hash.h"
+#include "easy_lib.h"
+#include "easy_table.h"
+#include "easy_table_item.h"
+
+#define LIST_KEY_LENGTH 16
+#define CHURN_KEYS      (1 << 14)
+#define CHURN_ROUNDS    8
+#define MIN_SECONDS     0.05
+#define NUM_TRIALS      5
+
+static struct EasyGenericObject
+new_text_key(size_t const i)
+{
+    char buffer[64] = {0};
+    snprintf(buffer, sizeof(buffer), "a-reasonably-long-text-key-%zu", i);
+    return (struct EasyGenericObject){
+        .type = EASY_TEXT_TYPE,
+        .data = {.text = EasyText__from_cstr(buffer)}};
+}
+
+/// @brief  Build a list of texts that only differs from its neighbours in the
+///         last element, so that a deep comparison must walk the whole list.
+static struct EasyGenericObject
+new_list_key(size_t const i)
+{
+    struct EasyListBuilder builder = EasyListBuilder__new_empty();
+    for (size_t j = 0; j < LIST_KEY_LENGTH; ++j) {
+        struct EasyGenericObject element =
+            new_text_key(j + 1 == LIST_KEY_LENGTH ? i : j);
+        EasyListBuilder__append(&builder, &element);
+        EasyGenericObject__destroy(&element);
+    }
+    return (struct EasyGenericObject){
+        .type = EASY_LIST_TYPE,
+        .data = {.list = EasyListBuilder__freeze(&builder)}};
+}
+
+static struct EasyGenericObject *
+new_keys(struct EasyGenericObject (*const new_key)(size_t),
+         size_t const offset,
+         size_t const num_keys)
+{
+    struct EasyGenericObject *keys = EASY_MALLOC(num_keys, sizeof(*keys));
+    for (size_t i = 0; i < num_keys; ++i) {
+        keys[i] = new_key(offset + i);
+    }
+    return keys;
+}
+
+static struct EasyGenericObject *
+copy_keys(struct EasyGenericObject const *const keys, size_t const num_keys)
+{
+    struct EasyGenericObject *copies = EASY_MALLOC(num_keys, sizeof(*copies));
+    for (size_t i = 0; i < num_keys; ++i) {
+        copies[i] = EasyGenericObject__copy(&keys[i]);
+    }
+    return copies;
+}
+
+static void
+destroy_keys(struct EasyGenericObject *const keys, size_t const num_keys)
+{
+    for (size_t i = 0; i < num_keys; ++i) {
+        EasyGenericObject__destroy(&keys[i]);
+    }
+    EASY_FREE(keys);
+}
+
+/// @brief  Time a pass of lookups, in nanoseconds per lookup. We take the
+///         best of several trials to filter out noise.
+static double
+time_lookups(struct EasyTable const *const table,
+             struct EasyGenericObject const *const keys,
+             size_t const num_keys)
+{
+    double best = 0.0;
+    for (size_t i = 0; i < NUM_TRIALS; ++i) {
+        size_t iterations = 0;
+        clock_t const start = clock();
+        clock_t end = start;
+        do {
+            for (size_t j = 0; j < num_keys; ++j) {
+                struct EasyGenericObject value =
+                    EasyTable__lookup(table, &keys[j]);
+                EasyGenericObject__destroy(&value);
+            }
+            iterations += num_keys;
+            end = clock();
+        } while ((double)(end - start) / CLOCKS_PER_SEC < MIN_SECONDS);
+        double const nsec =
+            1e9 * (double)(end - start) / CLOCKS_PER_SEC / (double)iterations;
+        best = i == 0 ? nsec : MIN(best, nsec);
+    }
+    return best;
+}
+
+/// @brief  Time a deep comparison of equal keys, in nanoseconds per call.
+static double
+time_deep_equal(struct EasyGenericObject const *const lhs,
+                struct EasyGenericObject const *const rhs,
+                size_t const num_keys)
+{
+    double best = 0.0;
+    size_t matches = 0;
+    for (size_t i = 0; i < NUM_TRIALS; ++i) {
+        size_t iterations = 0;
+        clock_t const start = clock();
+        clock_t end = start;
+        do {
+            for (size_t j = 0; j < num_keys; ++j) {
+                matches += EasyGenericObject__equal(&lhs[j], &rhs[j]);
+            }
+            iterations += num_keys;
+            end = clock();
+        } while ((double)(end - start) / CLOCKS_PER_SEC < MIN_SECONDS);
+        double const nsec =
+            1e9 * (double)(end - start) / CLOCKS_PER_SEC / (double)iterations;
+        best = i == 0 ? nsec : MIN(best, nsec);
+    }
+    EASY_ASSERT(matches != 0, "the keys should be equal");
+    return best;
+}
+
+static void
+bench_keys(char const *const name,
+           struct EasyGenericObject (*const new_key)(size_t),
+           size_t const num_keys)
+{
+    struct EasyGenericObject *const keys = new_keys(new_key, 0, num_keys);
+    struct EasyGenericObject *const fresh = new_keys(new_key, 0, num_keys);
+    struct EasyGenericObject *const copies = copy_keys(keys, num_keys);
+    struct EasyGenericObject *const absent =
+        new_keys(new_key, num_keys, num_keys);
+
+    struct EasyTableBuilder builder = EasyTableBuilder__new_empty();
+    for (size_t i = 0; i < num_keys; ++i) {
+        EasyTableBuilder__insert(&builder, &keys[i], &keys[i]);
+    }
+    struct EasyTable table = EasyTableBuilder__freeze(&builder);
+
+    /* Memoise the hashes of the unhashed keys before we deeply compare them,
+     * just as a lookup would */
+    for (size_t i = 0; i < num_keys; ++i) {
+        EasyGenericObject__hash(&fresh[i]);
+    }
+
+    printf("%8s %8zu %12.1f %12.1f %12.1f %12.1f\n",
+           name,
+           num_keys,
+           time_lookups(&table, fresh, num_keys),
+           time_lookups(&table, copies, num_keys),
+           time_lookups(&table, absent, num_keys),
+           time_deep_equal(keys, fresh, num_keys));
+
+    EasyTable__destroy(&table);
+    EasyTableBuilder__destroy(&builder);
+    destroy_keys(keys, num_keys);
+    destroy_keys(fresh, num_keys);
+    destroy_keys(copies, num_keys);
+    destroy_keys(absent, num_keys);
+}
+
+struct TrieShape {
+    size_t num_nodes;
+    size_t num_items;
+    size_t sum_depths; /* Sum over the items of the number of nodes above */
+};
+
+static void
+add_trie_shape(struct EasyTableNode const *const node,
+               size_t const depth,
+               struct TrieShape *const shape)
+{
+    ++shape->num_nodes;
+    shape->num_items += node->num_items;
+    shape->sum_depths += (depth + 1) * node->num_items;
+    for (size_t i = 0; i < node->num_nodes; ++i) {
+        add_trie_shape(node->slots[node->num_items + i].node, depth + 1, shape);
+    }
+}
+
+static void
+print_trie_shape(char const *const name, struct EasyTable const *const table)
+{
+    struct TrieShape shape = {0};
+    if (table->root != NULL) {
+        add_trie_shape(table->root, 0, &shape);
+    }
+    EASY_ASSERT(shape.num_items == table->length, "length mismatch");
+    printf("%16s %8zu %8zu %12.3f\n",
+           name,
+           shape.num_items,
+           shape.num_nodes,
+           (double)shape.sum_depths / (double)MAX(shape.num_items, 1));
+}
+
+static struct EasyTable
+remove_key(struct EasyTable *const table, struct EasyGenericObject const *key)
+{
+    struct EasyTable next = EasyTable__remove(table, key);
+    EasyTable__destroy(table);
+    return next;
+}
+
+static struct EasyTable
+insert_key(struct EasyTable *const table, struct EasyGenericObject const *key)
+{
+    struct EasyTable next = EasyTable__insert(table, key, key);
+    EasyTable__destroy(table);
+    return next;
+}
+
+static void
+bench_churn(void)
+{
+    size_t const total_keys = CHURN_KEYS * (CHURN_ROUNDS + 1);
+    struct EasyGenericObject *const keys =
+        new_keys(new_text_key, 0, total_keys);
+    struct EasyTable table = EasyTable__new_empty();
+    for (size_t i = 0; i < CHURN_KEYS; ++i) {
+        table = insert_key(&table, &keys[i]);
+    }
+
+    printf("%16s %8s %8s %12s\n", "table", "items", "nodes", "mean depth");
+    print_trie_shape("initial", &table);
+    for (size_t round = 0; round < CHURN_ROUNDS; ++round) {
+        size_t const oldest = round * CHURN_KEYS;
+        for (size_t i = 0; i < CHURN_KEYS; ++i) {
+            table = remove_key(&table, &keys[oldest + i]);
+            table = insert_key(&table, &keys[oldest + CHURN_KEYS + i]);
+        }
+        char name[32] = {0};
+        snprintf(name, sizeof(name), "churn round %zu", round + 1);
+        print_trie_shape(name, &table);
+    }
+
+    /* Delete all but every 16th key, then rebuild from the survivors */
+    size_t const newest = CHURN_ROUNDS * CHURN_KEYS;
+    struct EasyTable fresh = EasyTable__new_empty();
+    for (size_t i = 0; i < CHURN_KEYS; ++i) {
+        if (i % 16 == 0) {
+            fresh = insert_key(&fresh, &keys[newest + i]);
+        } else {
+            table = remove_key(&table, &keys[newest + i]);
+        }
+    }
+    print_trie_shape("mass delete", &table);
+    print_trie_shape("fresh", &fresh);
+
+    EasyTable__destroy(&table);
+    EasyTable__destroy(&fresh);
+    destroy_keys(keys, total_keys);
+}
+
+int
+main(void)
+{
+    size_t const sizes[] = {1 << 10, 1 << 14, 1 << 18};
+
+    printf("Nanoseconds per operation\n");
+    printf("%8s %8s %12s %12s %12s %12s\n",
+           "key",
+           "keys",
+           "hit (fresh)",
+           "hit (copy)",
+           "miss",
+           "deep equal");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i) {
+        bench_keys("text", new_text_key, sizes[i]);
+    }
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i) {
+        bench_keys("list", new_list_key, sizes[i]);
+    }
+    printf("\n");
+    bench_churn();
+    return 0;
+}
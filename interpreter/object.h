@@ -22,7 +22,8 @@ union ObjectData {
     void *nothing;
     bool boolean;
     double number;
-    char *string;
+    // NOTE Strings are immutable, since interned ones are shared.
+    char const *string;
     struct Array *array;
     struct Table *table;
     // TODO Function (basically a list of commands)
@@ -130,6 +131,8 @@ struct Object {
     struct Global const *global;
     struct ObjectType const *type;
     union ObjectData data;
+    // Whether the string comes from the intern pool (see string.c)
+    bool is_interned;
 };
 
 /// @note   This is for the sole purpose of checking that we initialize all
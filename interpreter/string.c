@@ -6,6 +6,135 @@
 #include "global.h"
 #include "object.h"
 
+/// @note   The strings that we parse with string_from_cstr come from an intern
+///         pool, so we store each distinct string once and equal strings
+///         compare by pointer. The pool counts the objects that use each
+///         string, so the strings must never change. The strings from
+///         string_ctor and string_slice are not interned, and the objects'
+///         is_interned flags let us free them without probing the pool. We
+///         probe the pool linearly and shift the following entries back when
+///         we remove one.
+struct InternedString {
+    char const *string; // NULL if the slot is empty
+    size_t hash;
+    size_t refcount;
+};
+
+struct InternPool {
+    struct InternedString *data;
+    size_t length;
+    size_t capacity; // A power of two (or zero)
+};
+
+#define INTERN_POOL_MIN_CAPACITY 64
+
+static struct InternPool intern_pool = {0};
+
+static size_t
+hash_string(char const *const string)
+{
+    // FNV-1a
+    size_t hash = (size_t)14695981039346656037ULL;
+    for (char const *c = string; *c != '\0'; ++c) {
+        hash = (hash ^ (unsigned char)*c) * (size_t)1099511628211ULL;
+    }
+    return hash;
+}
+
+/// @brief  Get the slot that holds a string, or the empty slot where it
+///         belongs.
+static size_t
+find_interned(struct InternedString const *const data,
+              size_t const capacity,
+              char const *const string,
+              size_t const hash)
+{
+    size_t const mask = capacity - 1;
+    size_t i = hash & mask;
+    while (data[i].string != NULL &&
+           (data[i].hash != hash || strcmp(data[i].string, string) != 0)) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static int
+grow_intern_pool(void)
+{
+    size_t const capacity = intern_pool.capacity == 0
+                                ? INTERN_POOL_MIN_CAPACITY
+                                : 2 * intern_pool.capacity;
+    struct InternedString *data = calloc(capacity, sizeof(*data));
+    if (data == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < intern_pool.capacity; ++i) {
+        struct InternedString const entry = intern_pool.data[i];
+        if (entry.string != NULL) {
+            data[find_interned(data, capacity, entry.string, entry.hash)] =
+                entry;
+        }
+    }
+    free(intern_pool.data);
+    intern_pool.data = data;
+    intern_pool.capacity = capacity;
+    return 0;
+}
+
+/// @brief  Get the canonical instance of a newly allocated string. We take
+///         ownership of the string, so we free it if it is a duplicate.
+static char const *
+intern_string(char *const string)
+{
+    if (2 * (intern_pool.length + 1) > intern_pool.capacity &&
+        grow_intern_pool()) {
+        free(string);
+        return NULL;
+    }
+    size_t const hash = hash_string(string);
+    size_t const i =
+        find_interned(intern_pool.data, intern_pool.capacity, string, hash);
+    struct InternedString *const entry = &intern_pool.data[i];
+    if (entry->string == NULL) {
+        *entry = (struct InternedString){
+            .string = string, .hash = hash, .refcount = 0};
+        ++intern_pool.length;
+    } else {
+        free(string);
+    }
+    ++entry->refcount;
+    return entry->string;
+}
+
+/// @brief  Drop a reference to an interned string, freeing it if this was the
+///         last reference.
+static void
+release_interned(char const *const string)
+{
+    size_t const mask = intern_pool.capacity - 1;
+    size_t i = find_interned(intern_pool.data,
+                             intern_pool.capacity,
+                             string,
+                             hash_string(string));
+    struct InternedString *const entry = &intern_pool.data[i];
+    assert(entry->string == string && "the string must be interned");
+    if (--entry->refcount != 0) {
+        return;
+    }
+    free((char *)entry->string);
+    --intern_pool.length;
+    // Shift back each following entry that may move closer to its home
+    for (size_t j = (i + 1) & mask; intern_pool.data[j].string != NULL;
+         j = (j + 1) & mask) {
+        size_t const home = intern_pool.data[j].hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            intern_pool.data[i] = intern_pool.data[j];
+            i = j;
+        }
+    }
+    intern_pool.data[i] = (struct InternedString){0};
+}
+
 static int
 string_error(struct Object const *const me)
 {
@@ -30,6 +159,7 @@ string_ctor(struct Object *const me,
     me->global = global;
     me->type = &global->builtin_types.string;
     me->data = data;
+    me->is_interned = false;
     return 0;
 }
 
@@ -40,7 +170,11 @@ string_dtor(struct Object *const me)
     if ((err = string_error(me))) {
         return err;
     }
-    free(me->data.string);
+    if (me->is_interned) {
+        release_interned(me->data.string);
+    } else {
+        free((char *)me->data.string);
+    }
     *me = (struct Object){0};
     return 0;
 }
@@ -60,7 +194,8 @@ string_cmp(struct Object const *const me,
     if (me->type->type != OBJECT_TYPE_STRING) {
         return -1;
     }
-    if (me == other) {
+    // Interned strings are equal exactly if they are the same string
+    if (me == other || me->data.string == other->data.string) {
         *result = 0;
         return 0;
     }
@@ -198,6 +333,7 @@ copy_parsed_cstr(char *const dst, char const *const src)
             }
             ++tmp_dst;
             ++tmp_src;
+            break;
         default:
             assert(*tmp_src != '\0');
             *tmp_dst = *tmp_src;
@@ -223,9 +359,14 @@ string_from_cstr(struct Object *const me,
     if (err) {
         return -1;
     }
-    me->data.string = malloc(length + 1);
-    copy_parsed_cstr(me->data.string, cstr);
-    return 0;
+    char *string = malloc(length + 1);
+    if (string == NULL) {
+        return -1;
+    }
+    copy_parsed_cstr(string, cstr);
+    me->data.string = intern_string(string);
+    me->is_interned = me->data.string != NULL;
+    return me->is_interned ? 0 : -1;
 }
 
 int
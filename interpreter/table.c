@@ -13,6 +13,8 @@
 static bool debug = true;
 
 #define MAX(x, y) ((x) > (y) ? (x) : (y))
+// The number of old slots that each operation moves while the table grows.
+#define TABLE_MIGRATE_STEPS 4
 #define FILTER(func_call)                                                      \
     do {                                                                       \
         int err = (func_call);                                                 \
@@ -34,6 +36,30 @@ hash(struct Object const *const x)
     return result;
 }
 
+static size_t
+get_home(size_t const capacity, struct Object const *const key)
+{
+    return hash(key) % capacity;
+}
+
+/// @brief  Check an array of slots, returning the number of valid nodes or
+///         SIZE_MAX if one is not the right distance from its home.
+static size_t
+count_nodes(struct TableNode const *const data, size_t const capacity)
+{
+    size_t cnt = 0;
+    for (size_t i = 0; i < capacity; ++i) {
+        if (data[i].status == TABLE_NODE_VALID) {
+            ++cnt;
+            size_t const home = get_home(capacity, data[i].key);
+            if ((home + data[i].distance) % capacity != i) {
+                return SIZE_MAX;
+            }
+        }
+    }
+    return cnt;
+}
+
 static bool
 ok(struct Table const *const me)
 {
@@ -44,102 +70,162 @@ ok(struct Table const *const me)
     if (me->data == NULL && me->capacity != 0) {
         return false;
     }
+    if (me->old_data == NULL && me->old_capacity != 0) {
+        return false;
+    }
     if (me->length > me->capacity) {
         return false;
     }
     // NOTE [EXPENSIVE] Check if the correct number of buckets are filled.
     if (debug) {
-        size_t cnt = 0;
-        for (size_t i = 0; i < me->capacity; ++i) {
-            if (me->data[i].status == TABLE_NODE_VALID) {
-                ++cnt;
-            }
-        }
-        if (cnt != me->length) {
-            return -1;
+        size_t const cnt = count_nodes(me->data, me->capacity);
+        size_t const old_cnt = count_nodes(me->old_data, me->old_capacity);
+        if (cnt == SIZE_MAX || old_cnt == SIZE_MAX ||
+            cnt + old_cnt != me->length) {
+            return false;
         }
     }
     // TODO [MAYBE?] Check for duplicates in the buckets.
     return true;
 }
 
-/// @brief  Get the index of the key or SIZE_MAX.
+/// @brief  Get the index of the key in an array of slots or SIZE_MAX.
 static size_t
-get_index(struct Table const *const me, struct Object const *const key)
+get_index(struct TableNode const *const data,
+          size_t const capacity,
+          struct Object const *const key)
 {
-    size_t const h = hash(key);
-    assert(me && me->data && me->capacity);
-    for (size_t i = 0; i < me->capacity; ++i) {
-        size_t idx = (h + i) % me->capacity;
-        if (me->data[idx].status == TABLE_NODE_VALID &&
-            me->data[idx].key == key) {
-            return idx;
-        }
-        // This means that we will NOT find the item!
-        if (me->data[idx].status == TABLE_NODE_INVALID) {
+    if (data == NULL) {
+        return SIZE_MAX;
+    }
+    size_t idx = get_home(capacity, key);
+    for (size_t distance = 0; distance < capacity; ++distance) {
+        struct TableNode const *const node = &data[idx];
+        // NOTE If the key were here, it would have displaced any node that is
+        //      closer to its home than we are to the key's home.
+        if (node->status != TABLE_NODE_VALID || node->distance < distance) {
             break;
         }
+        if (node->key == key) {
+            return idx;
+        }
+        idx = (idx + 1) % capacity;
     }
     return SIZE_MAX;
 }
 
-/// @brief  Get the would-be or actual index of the key or SIZE_MAX.
-static size_t
-get_maybe_index(struct Table const *const me, struct Object const *const key)
+/// @brief  Insert or update a key, assuming there is a free slot.
+/// @return Whether we added a new key.
+static bool
+insert_node(struct TableNode *const data,
+            size_t const capacity,
+            struct Object const *const key,
+            struct Object *const value)
 {
-    size_t const h = hash(key);
-    assert(me && me->data && me->capacity);
-    for (size_t i = 0; i < me->capacity; ++i) {
-        size_t idx = (h + i) % me->capacity;
-        // This means we've found the key!
-        // NOTE By placing this condition first, we optimize for updating an
-        //      existing key. #premature-optimization!
-        if (me->data[idx].status == TABLE_NODE_VALID &&
-            me->data[idx].key == key) {
-            return idx;
+    assert(data && capacity);
+    struct TableNode node = {
+        .status = TABLE_NODE_VALID, .distance = 0, .key = key, .value = value};
+    size_t idx = get_home(capacity, key);
+    while (true) {
+        struct TableNode *const slot = &data[idx];
+        if (slot->status != TABLE_NODE_VALID) {
+            *slot = node;
+            return true;
         }
-        // NOTE We are assuming the status is one of the enumerated values.
-        if (me->data[idx].status != TABLE_NODE_VALID) {
-            return idx;
+        // NOTE Once we displace a node, we are carrying a different key, which
+        //      is unique and so never matches.
+        if (slot->key == node.key) {
+            slot->value = node.value;
+            return false;
+        }
+        // Rob from the rich (close to home) to give to the poor (far away).
+        if (slot->distance < node.distance) {
+            struct TableNode const displaced = *slot;
+            *slot = node;
+            node = displaced;
         }
+        idx = (idx + 1) % capacity;
+        ++node.distance;
     }
-    return SIZE_MAX;
 }
 
+/// @brief  Remove the node at an index.
+static void
+remove_node(struct TableNode *const data, size_t const capacity, size_t idx)
+{
+    // Shift the following nodes back a slot until one is already at home.
+    // This leaves the slots exactly as if we had never inserted the key.
+    size_t next = (idx + 1) % capacity;
+    while (data[next].status == TABLE_NODE_VALID && data[next].distance != 0) {
+        data[idx] = data[next];
+        --data[idx].distance;
+        idx = next;
+        next = (next + 1) % capacity;
+    }
+    data[idx] = (struct TableNode){.status = TABLE_NODE_INVALID};
+}
+
+/// @brief  Move (up to) a number of the old slots into the new array.
+/// @note   We empty the old slots in order. Removing a node keeps the old
+///         array a valid table, so we can still look up the remaining keys.
+static void
+migrate(struct Table *const me, size_t const steps)
+{
+    for (size_t i = 0; i < steps && me->old_data != NULL; ++i) {
+        struct TableNode const node = me->old_data[me->migrated];
+        if (node.status == TABLE_NODE_VALID) {
+            insert_node(me->data, me->capacity, node.key, node.value);
+            // NOTE This may shift another node into the slot, so we stay put.
+            remove_node(me->old_data, me->old_capacity, me->migrated);
+        } else if (++me->migrated == me->old_capacity) {
+            free(me->old_data);
+            me->old_data = NULL;
+            me->old_capacity = 0;
+            me->migrated = 0;
+        }
+    }
+}
+
+/// @brief  Start moving the nodes into a bigger array.
+/// @note   Each operation then moves a few of the old slots (like Redis's
+///         incremental rehashing), so no single insert stalls while it rehashes
+///         a huge table. With TABLE_MIGRATE_STEPS >= 4, we finish long before
+///         the new array fills up, but we check anyway.
 static int
-grow(struct Table *const me)
+resize(struct Table *const me, size_t const capacity)
 {
-    struct Table new_table = {0};
     if (!ok(me)) {
         return -1;
     }
-    new_table.capacity = MAX(8, 2 * me->capacity);
-    new_table.data = calloc(new_table.capacity, sizeof(*new_table.data));
-    if (new_table.data == NULL) {
+    migrate(me, SIZE_MAX);
+    struct TableNode *const data = calloc(capacity, sizeof(*data));
+    if (data == NULL) {
         return ENOMEM;
     }
-    // Copy over data to new_table.
-    for (size_t i = 0; i < me->capacity; ++i) {
-        // NOTE We don't want to iterate was time searching an empty table!
-        if (new_table.length == me->length) {
-            break;
-        }
-        if (me->data[i].status == TABLE_NODE_VALID) {
-            size_t idx = get_maybe_index(&new_table, me->data[i].key);
-            assert(idx != SIZE_MAX);
-            new_table.data[i] = (struct TableNode){
-                .status = TABLE_NODE_VALID,
-                .key = me->data[i].key,
-                .value = me->data[i].value,
-            };
-            ++new_table.length;
-        }
+    if (me->length == 0) {
+        free(me->data);
+    } else {
+        me->old_data = me->data;
+        me->old_capacity = me->capacity;
+        me->migrated = 0;
     }
-    free(me->data);
-    *me = new_table;
+    me->data = data;
+    me->capacity = capacity;
     return 0;
 }
 
+static int
+grow(struct Table *const me)
+{
+    return resize(me, MAX(8, 2 * me->capacity));
+}
+
+static bool
+is_enough_room(size_t const length, size_t const capacity)
+{
+    return length < (double)2 / 3 * capacity;
+}
+
 int
 table_ctor(struct Table *const me)
 {
@@ -150,6 +236,23 @@ table_ctor(struct Table *const me)
     return grow(me);
 }
 
+int
+table_reserve(struct Table *const me, size_t const length)
+{
+    size_t capacity = 0;
+    if (me == NULL || me->data == NULL) {
+        return -1;
+    }
+    capacity = me->capacity;
+    while (!is_enough_room(length, capacity)) {
+        capacity *= 2;
+    }
+    if (capacity == me->capacity) {
+        return 0;
+    }
+    return resize(me, capacity);
+}
+
 int
 table_dtor(struct Table *const me)
 {
@@ -157,36 +260,48 @@ table_dtor(struct Table *const me)
         return -1;
     }
     free(me->data);
+    free(me->old_data);
     // TODO Destroy all objects.
     *me = (struct Table){0};
     return 0;
 }
 
-int
-table_fprint(struct Table const *const me, FILE *const fp, bool const newline)
+static void
+fprint_nodes(struct TableNode const *const data,
+             size_t const capacity,
+             size_t const length,
+             size_t *const cnt,
+             FILE *const fp)
 {
-    size_t cnt = 0;
-    if (me == NULL || me->data == NULL) {
-        return -1;
-    }
-    fprintf(fp, "(len: %zu, cap: %zu) {", me->length, me->capacity);
-    for (size_t i = 0; i < me->capacity; ++i) {
-        if (me->data[i].status == TABLE_NODE_VALID) {
-            ++cnt;
+    for (size_t i = 0; i < capacity; ++i) {
+        if (data[i].status == TABLE_NODE_VALID) {
+            ++*cnt;
             if (debug) {
                 fprintf(fp,
                         "%zu: %zu%s",
-                        (size_t)me->data[i].key,
-                        (size_t)me->data[i].value,
-                        cnt < me->length ? ", " : "");
+                        (size_t)data[i].key,
+                        (size_t)data[i].value,
+                        *cnt < length ? ", " : "");
             } else {
-                object_fprint(me->data[i].key, fp, false);
+                object_fprint(data[i].key, fp, false);
                 fprintf(fp, ": ");
-                object_fprint(me->data[i].value, fp, false);
-                fprintf(fp, "%s", cnt < me->length ? ", " : "");
+                object_fprint(data[i].value, fp, false);
+                fprintf(fp, "%s", *cnt < length ? ", " : "");
             }
         }
     }
+}
+
+int
+table_fprint(struct Table const *const me, FILE *const fp, bool const newline)
+{
+    size_t cnt = 0;
+    if (me == NULL || me->data == NULL) {
+        return -1;
+    }
+    fprintf(fp, "(len: %zu, cap: %zu) {", me->length, me->capacity);
+    fprint_nodes(me->old_data, me->old_capacity, me->length, &cnt, fp);
+    fprint_nodes(me->data, me->capacity, me->length, &cnt, fp);
     fprintf(fp, "}%s", newline ? "\n" : "");
     return 0;
 }
@@ -200,22 +315,19 @@ table_insert(struct Table *const me,
     if (me == NULL || me->data == NULL) {
         return -1;
     }
-    if (me->length >= (double)2 / 3 * me->capacity) {
+    migrate(me, TABLE_MIGRATE_STEPS);
+    if (!is_enough_room(me->length, me->capacity)) {
         FILTER(grow(me));
     }
-    idx = get_maybe_index(me, key);
-    if (idx == SIZE_MAX) {
-        return -1;
+    // NOTE If the key has not moved yet, we move it now.
+    idx = get_index(me->old_data, me->old_capacity, key);
+    if (idx != SIZE_MAX) {
+        remove_node(me->old_data, me->old_capacity, idx);
+        --me->length;
     }
-    // Add to the length if this is a new object!
-    if (me->data[idx].status != TABLE_NODE_VALID) {
+    if (insert_node(me->data, me->capacity, key, value)) {
         ++me->length;
     }
-    me->data[idx] = (struct TableNode){
-        .status = TABLE_NODE_VALID,
-        .key = key,
-        .value = value,
-    };
     return 0;
 }
 
@@ -231,12 +343,18 @@ table_get(struct Table *const me,
     if (value == NULL) {
         return -1;
     }
-    idx = get_index(me, key);
-    if (idx == SIZE_MAX) {
-        return -1;
+    migrate(me, TABLE_MIGRATE_STEPS);
+    idx = get_index(me->data, me->capacity, key);
+    if (idx != SIZE_MAX) {
+        *value = me->data[idx].value;
+        return 0;
     }
-    *value = me->data[idx].value;
-    return 0;
+    idx = get_index(me->old_data, me->old_capacity, key);
+    if (idx != SIZE_MAX) {
+        *value = me->old_data[idx].value;
+        return 0;
+    }
+    return -1;
 }
 
 int
@@ -251,14 +369,19 @@ table_remove(struct Table *const me,
     if (value == NULL) {
         return -1;
     }
-    idx = get_index(me, key);
-    if (idx == SIZE_MAX) {
-        return -1;
+    migrate(me, TABLE_MIGRATE_STEPS);
+    idx = get_index(me->data, me->capacity, key);
+    if (idx != SIZE_MAX) {
+        *value = me->data[idx].value;
+        remove_node(me->data, me->capacity, idx);
+    } else {
+        idx = get_index(me->old_data, me->old_capacity, key);
+        if (idx == SIZE_MAX) {
+            return -1;
+        }
+        *value = me->old_data[idx].value;
+        remove_node(me->old_data, me->old_capacity, idx);
     }
-    *value = me->data[idx].value;
-    me->data[idx] = (struct TableNode){.status = TABLE_NODE_TOMBSTONE,
-                                       .key = 0,
-                                       .value = 0};
     --me->length;
     return 0;
 }
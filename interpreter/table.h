@@ -9,19 +9,28 @@ enum TableNodeStatus {
     //      the array.
     TABLE_NODE_INVALID = 0,
     TABLE_NODE_VALID = 1,
-    TABLE_NODE_TOMBSTONE = 2,
 };
 
+/// @note   We use Robin Hood hashing: an insertion takes the slot of any node
+///         that is closer to its home slot than the insertion is to its own.
+///         This keeps the probe distances even, so removal can shift the
+///         following nodes back instead of leaving tombstones.
 struct TableNode {
     enum TableNodeStatus status;
+    size_t distance; // Number of slots past the node's home slot
     struct Object const *key;
     struct Object *value;
 };
 
 struct Table {
     struct TableNode *data;
-    size_t length;
+    size_t length; // Including the nodes that are still in the old array
     size_t capacity;
+    // NOTE While the table grows, the nodes are split between the new array
+    //      and the old one. Each operation moves a few of the old nodes.
+    struct TableNode *old_data; // NULL unless the table is growing
+    size_t old_capacity;
+    size_t migrated; // The number of old slots that we have emptied
 };
 
 int
@@ -30,7 +39,14 @@ table_ctor(struct Table *const me);
 int
 table_dtor(struct Table *const me);
 
-/// @brief  Write the table in the order of the hashes.
+/// @brief  Make room for a number of keys, so that inserting them does not
+///         grow the table again.
+int
+table_reserve(struct Table *const me, size_t const length);
+
+/// @brief  Write the table's entries in slot order. While the table is
+///         migrating, we write the entries that remain in the old array
+///         first and then those in the new one.
 int
 table_fprint(struct Table const *const me, FILE *const fp, bool const newline);
 
@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "boolean.h"
 #include "global.h"
@@ -147,6 +148,45 @@ test_string_from_cstr(struct Global const *const global,
     return 0;
 }
 
+/// @brief  Parse many strings twice, so that the pool grows and each string
+///         has two objects, then destroy them in an interleaved order.
+static int
+test_string_intern(struct Global const *const global)
+{
+    enum { NUM_STRINGS = 200 };
+    struct Object strings[2 * NUM_STRINGS] = {{0}};
+    char const *endptr = NULL;
+    char cstr[32] = {0};
+    for (size_t i = 0; i < 2 * NUM_STRINGS; ++i) {
+        snprintf(cstr, sizeof(cstr), "\"key %zu\"", i % NUM_STRINGS);
+        int err = global->builtin_types.string.from_cstr(&strings[i],
+                                                         global,
+                                                         cstr,
+                                                         &endptr);
+        assert(!err);
+    }
+    for (size_t i = 0; i < NUM_STRINGS; ++i) {
+        int result = -1;
+        struct Object *const a = &strings[i];
+        struct Object *const b = &strings[NUM_STRINGS + i];
+        assert(a->data.string == b->data.string && a->is_interned);
+        assert(!a->type->cmp(a, b, &result) && result == 0);
+    }
+    // Destroy the first copy of every third string, and then the rest
+    for (size_t i = 0; i < NUM_STRINGS; i += 3) {
+        strings[i].type->dtor(&strings[i]);
+    }
+    for (size_t i = 0; i < 2 * NUM_STRINGS; ++i) {
+        if (strings[i].type == NULL) {
+            continue;
+        }
+        snprintf(cstr, sizeof(cstr), "key %zu", i % NUM_STRINGS);
+        assert(strcmp(strings[i].data.string, cstr) == 0);
+        strings[i].type->dtor(&strings[i]);
+    }
+    return 0;
+}
+
 int
 main(void)
 {
@@ -258,6 +298,7 @@ main(void)
         &string,
         &global,
         (union ObjectData){.string = cstr_dup("Hello, World!")});
+    assert(!string.is_interned);
     string.type->fprint(&string, stdout, true);
 
     global.builtin_types.string.slice(&string, 3, 10, &string_slice);
@@ -270,6 +311,7 @@ main(void)
     test_string_from_cstr(&global, "\" \\a \\b \\\\ \"", 0, " \a \b \\ ");
     test_string_from_cstr(&global, " \\ ", -1, NULL);
     test_string_from_cstr(&global, "\" \\ ", -1, NULL);
+    test_string_intern(&global);
 
     return 0;
 }
@@ -53,6 +53,63 @@ main(void)
     err = table_remove(&t, (struct Object *)0, (struct Object **)&victim);
     assert(err == -1);
 
+    printf("> \tChurn keys without growing\n");
+    // NOTE Keys that share a factor with the capacity cluster together.
+    for (size_t i = 0; i < 16; ++i) {
+        err = table_insert(&t, (struct Object *)(4 * i), (struct Object *)i);
+        assert(!err);
+    }
+    size_t const capacity = t.capacity;
+    for (size_t i = 0; i < 1000; ++i) {
+        err = table_remove(&t,
+                           (struct Object *)(4 * i),
+                           (struct Object **)&victim);
+        assert(!err);
+        assert(victim == i);
+        err = table_insert(&t,
+                           (struct Object *)(4 * (i + 16)),
+                           (struct Object *)(i + 16));
+        assert(!err);
+        for (size_t j = i + 1; j < i + 17; ++j) {
+            err = table_get(&t,
+                            (struct Object *)(4 * j),
+                            (struct Object **)&victim);
+            assert(!err);
+            assert(victim == j);
+        }
+    }
+    // Removing leaves no tombstones, so the table never fills up.
+    assert(t.length == 16 && t.capacity == capacity);
+
+    printf("> \tGrow incrementally\n");
+    bool seen_growing = false;
+    for (size_t i = 1000; i < 2000; ++i) {
+        err = table_insert(&t, (struct Object *)i, (struct Object *)i);
+        assert(!err);
+        seen_growing |= t.old_data != NULL;
+        // Check the keys whether or not they have moved to the new array.
+        for (size_t j = 1000; j <= i; j += 37) {
+            err = table_get(&t, (struct Object *)j, (struct Object **)&victim);
+            assert(!err);
+            assert(victim == j);
+        }
+    }
+    assert(seen_growing && t.length == 1016);
+
+    err = table_dtor(&t);
+    assert(!err);
+
+    printf("> \tReserve room before inserting\n");
+    err = table_ctor(&t);
+    assert(!err);
+    err = table_reserve(&t, 1000);
+    assert(!err);
+    size_t const reserved_capacity = t.capacity;
+    for (size_t i = 0; i < 1000; ++i) {
+        err = table_insert(&t, (struct Object *)i, (struct Object *)i);
+        assert(!err);
+    }
+    assert(t.length == 1000 && t.capacity == reserved_capacity);
     err = table_dtor(&t);
     assert(!err);
     printf("OK!\n");
@@ -0,0 +1,236 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "easy_common.h"
+
+#include "easy_arena.h"
+
+/* The size of the first block. Each new block is twice as large as the last,
+ * so an arena only ever holds O(log n) blocks. */
+#define EASY_ARENA_FIRST_BLOCK_SIZE ((size_t)64 * 1024)
+
+/* We measure the blocks in units of this header */
+union EasyArenaHeader {
+    size_t size; /* The number of bytes that we allocated */
+    union EasyMaxAlign align;
+};
+
+struct EasyArenaBlock {
+    struct EasyArenaBlock *next; /* The next older block */
+    size_t capacity;             /* The number of units in the block */
+    size_t used;                 /* The number of units that we handed out */
+    union EasyArenaHeader data[];
+};
+
+/* The arenas that are still alive, so that we can tell which pointers belong
+ * to them. Memory from an arena may be freed on any thread, so every thread
+ * shares the list under a lock. We count the arenas so that freeing memory
+ * skips the lock while there are none (which is the common case). */
+static pthread_mutex_t live_arenas_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct EasyArena *live_arenas = NULL;
+static size_t num_live_arenas = 0;
+/* The arena that EASY_MALLOC and EASY_CALLOC use on this thread */
+static __thread struct EasyArena *current_arena = NULL;
+
+/// @brief  Get the number of units that an allocation needs, including its
+///         header.
+static size_t
+get_num_units(size_t const num_bytes)
+{
+    size_t const unit = sizeof(union EasyArenaHeader);
+    EASY_GUARD(num_bytes < SIZE_MAX - 2 * unit, "overflow");
+    return 1 + (num_bytes + unit - 1) / unit;
+}
+
+static struct EasyArenaBlock *
+new_block(size_t const capacity)
+{
+    EASY_GUARD(capacity < (SIZE_MAX - sizeof(struct EasyArenaBlock)) /
+                              sizeof(union EasyArenaHeader),
+               "overflow");
+    /* We get zeroed memory from calloc. Since we never reuse the memory in a
+     * block, every allocation is zeroed without a memset. */
+    struct EasyArenaBlock *block =
+        calloc(1,
+               sizeof(struct EasyArenaBlock) +
+                   capacity * sizeof(union EasyArenaHeader));
+    EASY_ASSERT(block != NULL, "out of memory");
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+static bool
+is_in_block(struct EasyArenaBlock const *const block, void const *const ptr)
+{
+    /* NOTE Comparing pointers into different objects is undefined, so we
+     *      compare their addresses instead. */
+    uintptr_t const addr = (uintptr_t)ptr;
+    uintptr_t const start = (uintptr_t)block->data;
+    uintptr_t const end = (uintptr_t)(block->data + block->capacity);
+    return start <= addr && addr < end;
+}
+
+static union EasyArenaHeader *
+get_header(void const *const ptr)
+{
+    return (union EasyArenaHeader *)ptr - 1;
+}
+
+struct EasyArena *
+EasyArena__new(void)
+{
+    /* The arena must not move, so we allocate it outside of any arena */
+    struct EasyArena *me = calloc(1, sizeof(*me));
+    EASY_ASSERT(me != NULL, "out of memory");
+    me->blocks = NULL;
+    me->num_bytes = 0;
+    EASY_ASSERT(pthread_mutex_lock(&live_arenas_lock) == 0, "cannot lock");
+    me->next_live = live_arenas;
+    live_arenas = me;
+    __atomic_add_fetch(&num_live_arenas, 1, __ATOMIC_RELEASE);
+    EASY_ASSERT(pthread_mutex_unlock(&live_arenas_lock) == 0, "cannot unlock");
+    return me;
+}
+
+void *
+EasyArena__alloc(struct EasyArena *const me,
+                 size_t const nmemb,
+                 size_t const size)
+{
+    EASY_GUARD(me != NULL, "arena must not be NULL");
+    EASY_GUARD(size == 0 || nmemb < SIZE_MAX / size, "overflow");
+    size_t const num_bytes = nmemb * size;
+    size_t const num_units = get_num_units(num_bytes);
+    struct EasyArenaBlock *block = me->blocks;
+    if (block == NULL || block->capacity - block->used < num_units) {
+        size_t const last_capacity =
+            block == NULL ? EASY_ARENA_FIRST_BLOCK_SIZE /
+                                sizeof(union EasyArenaHeader) / 2
+                          : block->capacity;
+        block = new_block(MAX(2 * last_capacity, num_units));
+        /* Other threads may be looking for a pointer's owner in our blocks */
+        EASY_ASSERT(pthread_mutex_lock(&live_arenas_lock) == 0, "cannot lock");
+        block->next = me->blocks;
+        me->blocks = block;
+        EASY_ASSERT(pthread_mutex_unlock(&live_arenas_lock) == 0,
+                    "cannot unlock");
+        me->num_bytes += block->capacity * sizeof(union EasyArenaHeader);
+    }
+    union EasyArenaHeader *header = &block->data[block->used];
+    block->used += num_units;
+    header->size = num_bytes;
+    return header + 1;
+}
+
+void *
+EasyArena__realloc(struct EasyArena *const me,
+                   void *const ptr,
+                   size_t const nmemb,
+                   size_t const size)
+{
+    EASY_GUARD(me != NULL && ptr != NULL, "pointers must not be NULL");
+    EASY_GUARD(EasyArena__owner(ptr) == me, "pointer is not from the arena");
+    EASY_GUARD(size == 0 || nmemb < SIZE_MAX / size, "overflow");
+    size_t const num_bytes = nmemb * size;
+    union EasyArenaHeader *const header = get_header(ptr);
+    size_t const old_num_bytes = header->size;
+    size_t const old_num_units = get_num_units(old_num_bytes);
+    size_t const num_units = get_num_units(num_bytes);
+
+    if (num_units <= old_num_units) {
+        /* Keep the units, but zero the bytes we released in case we grow the
+         * allocation into them again */
+        if (num_bytes < old_num_bytes) {
+            memset((char *)ptr + num_bytes, 0, old_num_bytes - num_bytes);
+        }
+        header->size = num_bytes;
+        return ptr;
+    }
+    struct EasyArenaBlock *const block = me->blocks;
+    bool const is_newest =
+        is_in_block(block, ptr) &&
+        header + old_num_units == &block->data[block->used];
+    size_t const extra_units = num_units - old_num_units;
+    if (is_newest && block->capacity - block->used >= extra_units) {
+        block->used += extra_units;
+        header->size = num_bytes;
+        return ptr;
+    }
+    void *const new_ptr = EasyArena__alloc(me, nmemb, size);
+    memcpy(new_ptr, ptr, old_num_bytes);
+    return new_ptr;
+}
+
+struct EasyArena *
+EasyArena__enter(struct EasyArena *const me)
+{
+    struct EasyArena *const previous = current_arena;
+    current_arena = me;
+    return previous;
+}
+
+void
+EasyArena__exit(struct EasyArena *const previous)
+{
+    current_arena = previous;
+}
+
+struct EasyArena *
+EasyArena__current(void)
+{
+    return current_arena;
+}
+
+struct EasyArena *
+EasyArena__owner(void const *const ptr)
+{
+    /* If we got the pointer from an arena, then we already synchronized with
+     * the thread that created it, so we would see it in the count */
+    if (__atomic_load_n(&num_live_arenas, __ATOMIC_ACQUIRE) == 0) {
+        return NULL;
+    }
+    struct EasyArena *owner = NULL;
+    EASY_ASSERT(pthread_mutex_lock(&live_arenas_lock) == 0, "cannot lock");
+    for (struct EasyArena *arena = live_arenas; arena != NULL && owner == NULL;
+         arena = arena->next_live) {
+        for (struct EasyArenaBlock const *block = arena->blocks; block != NULL;
+             block = block->next) {
+            if (is_in_block(block, ptr)) {
+                owner = arena;
+                break;
+            }
+        }
+    }
+    EASY_ASSERT(pthread_mutex_unlock(&live_arenas_lock) == 0, "cannot unlock");
+    return owner;
+}
+
+void
+EasyArena__destroy(struct EasyArena *const me)
+{
+    EASY_GUARD(me != NULL, "arena must not be NULL");
+    EASY_GUARD(me != current_arena, "cannot destroy the current arena");
+    EASY_ASSERT(pthread_mutex_lock(&live_arenas_lock) == 0, "cannot lock");
+    struct EasyArena **link = &live_arenas;
+    while (*link != me) {
+        EASY_ASSERT(*link != NULL, "arena is not alive");
+        link = &(*link)->next_live;
+    }
+    *link = me->next_live;
+    __atomic_sub_fetch(&num_live_arenas, 1, __ATOMIC_RELEASE);
+    EASY_ASSERT(pthread_mutex_unlock(&live_arenas_lock) == 0, "cannot unlock");
+
+    struct EasyArenaBlock *block = me->blocks;
+    while (block != NULL) {
+        struct EasyArenaBlock *const next = block->next;
+        free(block);
+        block = next;
+    }
+    free(me);
+}
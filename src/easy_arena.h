@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct EasyArenaBlock;
+
+/* EasyArena
+ * This is explicitly Mutable. It hands out memory by bumping a pointer through
+ * large blocks, and it frees every block at once when we destroy it.
+ *
+ * Entering an arena routes EASY_MALLOC and EASY_CALLOC (and so every object we
+ * create) to it until we exit. Freeing memory from an arena does nothing, so
+ * destroying objects that live in it is safe but unnecessary: destroying the
+ * arena releases them all. We must not touch them after that, though.
+ *
+ * Each thread enters arenas independently, so entering one only routes that
+ * thread's allocations to it. Memory from an arena may be freed on any thread.
+ *
+ * NOTE The allocator keeps track of the live arenas, so an arena must stay at
+ *      the address that EasyArena__new returned.
+ * NOTE An arena itself is not synchronized: only one thread at a time may
+ *      allocate from it, and no thread may be in it when we destroy it.
+ */
+struct EasyArena {
+    struct EasyArenaBlock *blocks; /* The newest block comes first */
+    size_t num_bytes;              /* The number of bytes in all the blocks */
+    struct EasyArena *next_live;   /* The next arena that is still alive */
+};
+
+struct EasyArena *
+EasyArena__new(void);
+/// @brief  Allocate memory from the arena. The memory is zeroed, since we
+///         never reuse it within a block.
+void *
+EasyArena__alloc(struct EasyArena *const me,
+                 size_t const nmemb,
+                 size_t const size);
+/// @brief  Route this thread's EASY_MALLOC and EASY_CALLOC to the arena (or
+///         to the heap if it is NULL). We return the previous arena, which we
+///         should pass to EasyArena__exit at the end of the scope.
+struct EasyArena *
+EasyArena__enter(struct EasyArena *const me);
+void
+EasyArena__exit(struct EasyArena *const previous);
+void
+EasyArena__destroy(struct EasyArena *const me);
+
+/// @brief  Get the arena that this thread's EASY_MALLOC and EASY_CALLOC
+///         currently use, or NULL for the heap.
+struct EasyArena *
+EasyArena__current(void);
+/// @brief  Find the live arena that a pointer came from, or NULL if it came
+///         from the heap.
+struct EasyArena *
+EasyArena__owner(void const *const ptr);
+/// @brief  Resize an allocation from an arena. We grow the newest allocation in
+///         place if there is room, and otherwise we copy it to a new one.
+void *
+EasyArena__realloc(struct EasyArena *const me,
+                   void *const ptr,
+                   size_t const nmemb,
+                   size_t const size);
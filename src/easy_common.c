@@ -4,7 +4,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "easy_arena.h"
 #include "easy_common.h"
+#include "easy_pool.h"
+#include "easy_telemetry.h"
 
 /*******************************************************************************
  *  ERROR PRINTING FUNCTIONS
@@ -38,10 +41,15 @@ _easy_assert(int const condition,
  *  MEMORY MANAGEMENT
  ******************************************************************************/
 
-void *
-_easy_calloc(size_t nmemb, size_t size, char *file, int line)
+/* Get memory from the current arena or from the pools */
+static void *
+alloc_raw(size_t const num_bytes, char *file, int line)
 {
-    void *ptr = calloc(nmemb, size);
+    struct EasyArena *const arena = EasyArena__current();
+    if (arena != NULL) {
+        return EasyArena__alloc(arena, 1, num_bytes);
+    }
+    void *ptr = EasyPool__alloc(num_bytes);
     if (ptr == NULL) {
         easy_print_error("out of memory", file, line);
         exit(EXIT_FAILURE);
@@ -49,18 +57,105 @@ _easy_calloc(size_t nmemb, size_t size, char *file, int line)
     return ptr;
 }
 
+static void *
+realloc_raw(void *ptr, size_t const num_bytes, char *file, int line)
+{
+    /* Memory stays in the arena that it came from */
+    struct EasyArena *const owner = EasyArena__owner(ptr);
+    if (owner != NULL) {
+        return EasyArena__realloc(owner, ptr, 1, num_bytes);
+    }
+    void *new_ptr = EasyPool__realloc(ptr, num_bytes);
+    if (new_ptr == NULL && num_bytes > 0) { /* What if num_bytes == 0? */
+        easy_print_error("out of memory", file, line);
+        exit(EXIT_FAILURE);
+    }
+    return new_ptr;
+}
+
+static void
+free_raw(void *ptr)
+{
+    /* We free an arena's memory all at once, when we destroy the arena */
+    if (EasyArena__owner(ptr) != NULL) {
+        return;
+    }
+    EasyPool__free(ptr);
+}
+
+#ifdef EASY_MEMORY_TELEMETRY
+/* With telemetry, we prefix each allocation with its size and callsite */
+union EasyTelemetryHeader {
+    struct {
+        size_t num_bytes;
+        size_t callsite;
+    } info;
+    union EasyMaxAlign align;
+};
+
+void *
+_easy_calloc(size_t nmemb, size_t size, char *file, int line)
+{
+    EASY_GUARD(size == 0 || nmemb < SIZE_MAX / size, "overflow");
+    size_t const num_bytes = nmemb * size;
+    EASY_GUARD(num_bytes < SIZE_MAX - sizeof(union EasyTelemetryHeader),
+               "overflow");
+    union EasyTelemetryHeader *header =
+        alloc_raw(sizeof(*header) + num_bytes, file, line);
+    header->info.num_bytes = num_bytes;
+    header->info.callsite =
+        EasyTelemetry__record_alloc(file, line, num_bytes);
+    return header + 1;
+}
+
 void *
 _easy_realloc(void *ptr, size_t nmemb, size_t size, char *file, int line)
 {
     EASY_GUARD(nmemb > 0 && size > 0, "nmemb and size should be positive");
-    EASY_GUARD(nmemb > SIZE_MAX / size, "overflow");
-    const size_t new_size = nmemb * size;
-    void *new_ptr = realloc(ptr, new_size);
-    if (new_ptr == NULL && new_size > 0) { /* What if new_size == 0? */
-        easy_print_error("out of memory", file, line);
+    EASY_GUARD(nmemb < SIZE_MAX / size, "overflow");
+    if (ptr == NULL) {
+        return _easy_calloc(nmemb, size, file, line);
+    }
+    size_t const num_bytes = nmemb * size;
+    EASY_GUARD(num_bytes < SIZE_MAX - sizeof(union EasyTelemetryHeader),
+               "overflow");
+    union EasyTelemetryHeader *header = (union EasyTelemetryHeader *)ptr - 1;
+    EasyTelemetry__record_free(header->info.callsite, header->info.num_bytes);
+    header = realloc_raw(header, sizeof(*header) + num_bytes, file, line);
+    header->info.num_bytes = num_bytes;
+    header->info.callsite =
+        EasyTelemetry__record_alloc(file, line, num_bytes);
+    return header + 1;
+}
+
+void
+_easy_free(void *ptr, char *file, int line)
+{
+    if (ptr == NULL) {
+        easy_print_error("freeing null pointer", file, line);
         exit(EXIT_FAILURE);
     }
-    return new_ptr;
+    union EasyTelemetryHeader *header = (union EasyTelemetryHeader *)ptr - 1;
+    EasyTelemetry__record_free(header->info.callsite, header->info.num_bytes);
+    free_raw(header);
+}
+#else
+void *
+_easy_calloc(size_t nmemb, size_t size, char *file, int line)
+{
+    EASY_GUARD(size == 0 || nmemb < SIZE_MAX / size, "overflow");
+    return alloc_raw(nmemb * size, file, line);
+}
+
+void *
+_easy_realloc(void *ptr, size_t nmemb, size_t size, char *file, int line)
+{
+    EASY_GUARD(nmemb > 0 && size > 0, "nmemb and size should be positive");
+    EASY_GUARD(nmemb < SIZE_MAX / size, "overflow");
+    if (ptr == NULL) {
+        return _easy_calloc(nmemb, size, file, line);
+    }
+    return realloc_raw(ptr, nmemb * size, file, line);
 }
 
 void
@@ -70,7 +165,79 @@ _easy_free(void *ptr, char *file, int line)
         easy_print_error("freeing null pointer", file, line);
         exit(EXIT_FAILURE);
     }
-    free(ptr);
+    free_raw(ptr);
+}
+#endif
+
+/*******************************************************************************
+ *  SHARED MEMORY
+ ******************************************************************************/
+
+union EasySharedHeader {
+    size_t refcount;
+    union EasyMaxAlign align;
+};
+
+static union EasySharedHeader *
+get_shared_header(void const *const ptr)
+{
+    EASY_GUARD(ptr != NULL, "shared pointer must not be NULL");
+    union EasySharedHeader *header = (union EasySharedHeader *)ptr - 1;
+    EASY_ASSERT(__atomic_load_n(&header->refcount, __ATOMIC_RELAXED) != 0,
+                "use after free of shared pointer");
+    return header;
+}
+
+void *
+_easy_shared_alloc(size_t nmemb, size_t size, char *file, int line)
+{
+    EASY_GUARD(size == 0 || nmemb < SIZE_MAX / size, "overflow");
+    size_t const payload_size = nmemb * size;
+    EASY_GUARD(payload_size < SIZE_MAX - sizeof(union EasySharedHeader),
+               "overflow");
+    union EasySharedHeader *header =
+        _easy_calloc(1, sizeof(*header) + payload_size, file, line);
+    header->refcount = 1;
+    return header + 1;
+}
+
+void *
+_easy_shared_retain(void *ptr)
+{
+    union EasySharedHeader *header = get_shared_header(ptr);
+    /* Copies on other threads may retain and release the buffer at the same
+     * time. Taking a reference needs no ordering, since the caller already
+     * holds one. */
+    size_t const refcount =
+        __atomic_add_fetch(&header->refcount, 1, __ATOMIC_RELAXED);
+    EASY_ASSERT(refcount != 0, "refcount overflow");
+    return ptr;
+}
+
+bool
+_easy_shared_release(void *ptr)
+{
+    union EasySharedHeader *header = get_shared_header(ptr);
+    /* Whoever drops the last reference must see every other thread's writes
+     * before it destroys the contents */
+    return __atomic_sub_fetch(&header->refcount, 1, __ATOMIC_ACQ_REL) == 0;
+}
+
+bool
+_easy_shared_is_unique(void const *ptr)
+{
+    return __atomic_load_n(&get_shared_header(ptr)->refcount,
+                           __ATOMIC_ACQUIRE) == 1;
+}
+
+void
+_easy_shared_free(void *ptr, char *file, int line)
+{
+    EASY_GUARD(ptr != NULL, "shared pointer must not be NULL");
+    union EasySharedHeader *header = (union EasySharedHeader *)ptr - 1;
+    EASY_ASSERT(__atomic_load_n(&header->refcount, __ATOMIC_ACQUIRE) == 0,
+                "freeing shared pointer with live references");
+    _easy_free(header, file, line);
 }
 
 /*******************************************************************************
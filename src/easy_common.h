@@ -3,6 +3,7 @@
 #ifndef EASYCOMMON_H
 #define EASYCOMMON_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /*******************************************************************************
@@ -33,9 +34,25 @@ _easy_assert(int const condition,
  *  MEMORY MANAGEMENT
  ******************************************************************************/
 
+/** A header that embeds this union is aligned as strictly as anything that
+ *  malloc returns, and so is the memory just after it. Each of our allocators
+ *  puts such a header before the memory that it hands out.
+ */
+union EasyMaxAlign {
+    long double align_long_double;
+    long long align_long_long;
+    void *align_pointer;
+};
+
 /** Allocate potentially uninitialized memory.
  *  NOTE    I return memory initialized to zero, but I do not guarantee that
  *          this is the case!
+ *  NOTE    Within an EasyArena's scope, these allocate from the arena (see
+ *          easy_arena.h) and freeing the memory does nothing.
+ *  NOTE    Otherwise, small allocations come from EasyPool's per-thread
+ *          size-class pools (see easy_pool.h).
+ *  NOTE    With -DEASY_MEMORY_TELEMETRY, we count the bytes that each callsite
+ *          allocates (see easy_telemetry.h).
  */
 #define EASY_MALLOC(nmemb, size) _easy_calloc(nmemb, size, __FILE__, __LINE__)
 #define EASY_CALLOC(nmemb, size) _easy_calloc(nmemb, size, __FILE__, __LINE__)
@@ -52,6 +69,45 @@ _easy_realloc(void *ptr, size_t nmemb, size_t size, char *file, int line);
 void
 _easy_free(void *ptr, char *file, int line);
 
+/*******************************************************************************
+ *  SHARED MEMORY
+ ******************************************************************************/
+
+/** Our objects are immutable, so copies can share a single buffer. We keep a
+ *  reference count in a header just before the buffer that we hand out.
+ *
+ *  NOTE    Dropping the last reference does not free the buffer, because the
+ *          caller may need to destroy its contents first (e.g. a list of
+ *          objects). The caller must call EASY_SHARED_FREE afterward.
+ *  NOTE    An owner that is about to drop a buffer may modify it in place
+ *          instead of duplicating it, if EASY_SHARED_IS_UNIQUE says that no
+ *          copy shares it.
+ *  NOTE    The reference counts are atomic, so copies of one object may be
+ *          made and destroyed on different threads.
+ */
+#define EASY_SHARED_ALLOC(nmemb, size)                                         \
+    _easy_shared_alloc(nmemb, size, __FILE__, __LINE__)
+#define EASY_SHARED_RETAIN(ptr)    _easy_shared_retain(ptr)
+#define EASY_SHARED_RELEASE(ptr)   _easy_shared_release(ptr)
+#define EASY_SHARED_IS_UNIQUE(ptr) _easy_shared_is_unique(ptr)
+#define EASY_SHARED_FREE(ptr)      _easy_shared_free(ptr, __FILE__, __LINE__)
+
+void *
+_easy_shared_alloc(size_t nmemb, size_t size, char *file, int line);
+
+void *
+_easy_shared_retain(void *ptr);
+
+/** Return true if we dropped the last reference. */
+bool
+_easy_shared_release(void *ptr);
+
+bool
+_easy_shared_is_unique(void const *ptr);
+
+void
+_easy_shared_free(void *ptr, char *file, int line);
+
 /*******************************************************************************
  *  MEMORY MANIPULATION
  ******************************************************************************/
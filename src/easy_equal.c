@@ -10,6 +10,18 @@
 
 #include "easy_equal.h"
 
+/// @brief  Objects with different memoised hashes cannot be equal. This lets us
+///         skip the deep comparison, which is recursive for nested keys.
+/// @note   A hash of zero means that we have not computed it yet. Another
+///         thread may be filling in either memo, so we load them atomically.
+static inline bool
+is_hash_mismatch(uint64_t const *const lhs_memo, uint64_t const *const rhs_memo)
+{
+    uint64_t const lhs_hash = __atomic_load_n(lhs_memo, __ATOMIC_RELAXED);
+    uint64_t const rhs_hash = __atomic_load_n(rhs_memo, __ATOMIC_RELAXED);
+    return lhs_hash != 0 && rhs_hash != 0 && lhs_hash != rhs_hash;
+}
+
 /// @note   We need check the elements individually. We can't just compare
 ///         the buffers but actually need to perform lookups.
 static inline bool
@@ -26,12 +38,18 @@ EasyList__equal(struct EasyList const *const lhs,
                 struct EasyList const *const rhs)
 {
     EASY_GUARD(lhs != NULL && rhs != NULL, "pointers should not be NULL");
-    if (lhs->length != rhs->length) {
+    if (lhs->length != rhs->length ||
+        is_hash_mismatch(&lhs->hash, &rhs->hash)) {
         return false;
     }
+    /* Copies share their (immutable) nodes */
+    if (lhs->root == rhs->root && lhs->tail == rhs->tail) {
+        return true;
+    }
     const size_t length = lhs->length;
     for (size_t i = 0; i < length; ++i) {
-        if (!EasyGenericObject__equal(&lhs->data[i], &rhs->data[i])) {
+        if (!EasyGenericObject__equal(EasyList__get(lhs, i),
+                                      EasyList__get(rhs, i))) {
             return false;
         }
     }
@@ -43,11 +61,18 @@ EasyText__equal(struct EasyText const *const lhs,
                 struct EasyText const *const rhs)
 {
     EASY_GUARD(lhs != NULL && rhs != NULL, "pointers should not be NULL");
-    if (lhs->length != rhs->length) {
+    if (lhs->length != rhs->length ||
+        is_hash_mismatch(&lhs->hash, &rhs->hash)) {
         return false;
     }
+    /* Copies of large texts share their (immutable) buffer */
+    if (lhs->data != NULL && lhs->data == rhs->data) {
+        return true;
+    }
     const size_t length = lhs->length;
-    return memcmp(lhs->data, rhs->data, length * sizeof(*lhs->data)) == 0;
+    return memcmp(EasyText__get_data(lhs),
+                  EasyText__get_data(rhs),
+                  length * sizeof(char)) == 0;
 }
 
 static inline bool
@@ -55,9 +80,14 @@ EasyInteger__equal(struct EasyInteger const *const lhs,
                    struct EasyInteger const *const rhs)
 {
     EASY_GUARD(lhs != NULL && rhs != NULL, "pointers should not be NULL");
-    if (lhs->length != rhs->length) {
+    if (lhs->sign != rhs->sign || lhs->length != rhs->length ||
+        is_hash_mismatch(&lhs->hash, &rhs->hash)) {
         return false;
     }
+    /* Integers are canonical, so a small value never equals a large one */
+    if (lhs->data == NULL || rhs->data == NULL) {
+        return lhs->data == rhs->data && lhs->small == rhs->small;
+    }
     const size_t length = lhs->length;
     return memcmp(lhs->data, rhs->data, length * sizeof(*lhs->data)) == 0;
 }
@@ -157,9 +187,19 @@ test_equal_easy_text(void)
     EASY_TEST_ASSERT_TRUE(a_eq_b);
     EASY_TEST_ASSERT_TRUE(!a_neq_c);
 
+    /* Copies share a buffer, and differing memoised hashes short-circuit */
+    struct EasyText d = EasyText__copy(&a);
+    EASY_TEST_ASSERT_TRUE(EasyText__equal(&a, &d));
+    a.hash = 1;
+    c.hash = 2;
+    EASY_TEST_ASSERT_TRUE(!EasyText__equal(&a, &c));
+    b.hash = 1;
+    EASY_TEST_ASSERT_TRUE(EasyText__equal(&a, &b));
+
     EasyText__destroy(&a);
     EasyText__destroy(&b);
     EasyText__destroy(&c);
+    EasyText__destroy(&d);
     return true;
 }
 
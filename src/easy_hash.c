@@ -1,5 +1,11 @@
+#include <pthread.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "easy_boolean.h"
 #include "easy_common.h"
@@ -8,59 +14,233 @@
 
 #include "easy_hash.h"
 #include "easy_nothing.h"
-#include "easy_table_item.h"
 #include "easy_text.h"
 
-#define DJB2_INITIAL_SEED 5381ULL
+/*******************************************************************************
+ *  XXH64
+ *  Source: https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+ ******************************************************************************/
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+#define STRIPE_LENGTH 32
+
+static inline uint64_t
+rotate_left(uint64_t const x, unsigned const bits)
+{
+    return (x << bits) | (x >> (64 - bits));
+}
+
+/// @note   The hash only has to be consistent within a process, so we read in
+///         native byte order rather than the reference's little-endian order.
+static inline uint64_t
+read_u64(unsigned char const *const p)
+{
+    uint64_t x = 0;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+static inline uint32_t
+read_u32(unsigned char const *const p)
+{
+    uint32_t x = 0;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
 
-/// @brief  A simple hash function for a memory buffer.
-/// @note   Adapted from the DJB2 hash function.
-/// @note   My goal is that if we call this hash function on the same
-///         buffer, we get the same results even if we divide up the
-///         buffer into smaller pieces.
-/// Source: http://www.cse.yorku.ca/~oz/hash.html
 static inline uint64_t
-_djb2_hash(void const *const buffer, size_t const size, uint64_t const seed)
+round_lane(uint64_t lane, uint64_t const input)
+{
+    lane += input * PRIME64_2;
+    lane = rotate_left(lane, 31);
+    return lane * PRIME64_1;
+}
+
+static inline uint64_t
+merge_lane(uint64_t hash, uint64_t const lane)
+{
+    hash ^= round_lane(0, lane);
+    return hash * PRIME64_1 + PRIME64_4;
+}
+
+static inline void
+consume_stripe(uint64_t lanes[4], unsigned char const *const stripe)
+{
+    for (size_t i = 0; i < 4; ++i) {
+        lanes[i] = round_lane(lanes[i], read_u64(&stripe[8 * i]));
+    }
+}
+
+/* Every thread must hash with the same seed, or equal objects would hash
+ * differently, so we pick it exactly once. */
+static pthread_once_t seed_once = PTHREAD_ONCE_INIT;
+static uint64_t seed = 0;
+
+static void
+init_seed(void)
 {
-    uint64_t hash = seed;
-    for (size_t i = 0; i < size; ++i) {
-        hash =
-            ((hash << 5) + hash) + ((uint8_t *)buffer)[i]; /* hash * 33 + c */
+    char const *const seed_str = getenv("EASY_HASH_SEED");
+    if (seed_str != NULL) {
+        seed = strtoull(seed_str, NULL, 0);
+        return;
+    }
+    FILE *fp = fopen("/dev/urandom", "rb");
+    if (fp == NULL || fread(&seed, sizeof(seed), 1, fp) != 1) {
+        /* This is weaker, but better than a fixed seed */
+        seed = (uint64_t)time(NULL) ^ (uint64_t)(uintptr_t)&seed;
+    }
+    if (fp != NULL) {
+        fclose(fp);
     }
+}
+
+uint64_t
+EasyHash__seed(void)
+{
+    EASY_ASSERT(pthread_once(&seed_once, init_seed) == 0,
+                "cannot initialize the hash seed");
+    return seed;
+}
+
+struct EasyHashState
+EasyHashState__new(uint64_t const seed)
+{
+    return (struct EasyHashState){
+        .lanes = {seed + PRIME64_1 + PRIME64_2,
+                  seed + PRIME64_2,
+                  seed,
+                  seed - PRIME64_1},
+        .seed = seed,
+    };
+}
+
+void
+EasyHashState__update(struct EasyHashState *const me,
+                      void const *const buffer,
+                      size_t const size)
+{
+    EASY_GUARD(me != NULL, "me should not be NULL");
+    EASY_GUARD(buffer != NULL || size == 0, "buffer should not be NULL");
+    unsigned char const *input = buffer;
+    unsigned char const *const end = input + size;
+    me->total_length += size;
+
+    /* Top up a partial stripe from the previous update */
+    if (me->buffer_length + size < STRIPE_LENGTH) {
+        memcpy(&me->buffer[me->buffer_length], input, size);
+        me->buffer_length += size;
+        return;
+    }
+    if (me->buffer_length != 0) {
+        size_t const num_needed = STRIPE_LENGTH - me->buffer_length;
+        memcpy(&me->buffer[me->buffer_length], input, num_needed);
+        consume_stripe(me->lanes, me->buffer);
+        input += num_needed;
+        me->buffer_length = 0;
+    }
+    for (; end - input >= STRIPE_LENGTH; input += STRIPE_LENGTH) {
+        consume_stripe(me->lanes, input);
+    }
+    memcpy(me->buffer, input, (size_t)(end - input));
+    me->buffer_length = (size_t)(end - input);
+}
+
+uint64_t
+EasyHashState__digest(struct EasyHashState const *const me)
+{
+    EASY_GUARD(me != NULL, "me should not be NULL");
+    uint64_t hash = 0;
+    if (me->total_length >= STRIPE_LENGTH) {
+        hash = rotate_left(me->lanes[0], 1) + rotate_left(me->lanes[1], 7) +
+               rotate_left(me->lanes[2], 12) + rotate_left(me->lanes[3], 18);
+        for (size_t i = 0; i < 4; ++i) {
+            hash = merge_lane(hash, me->lanes[i]);
+        }
+    } else {
+        hash = me->seed + PRIME64_5;
+    }
+    hash += me->total_length;
+
+    /* Mix in the tail, 8 bytes at a time where possible */
+    unsigned char const *p = me->buffer;
+    unsigned char const *const end = p + me->buffer_length;
+    for (; end - p >= 8; p += 8) {
+        hash ^= round_lane(0, read_u64(p));
+        hash = rotate_left(hash, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (end - p >= 4) {
+        hash ^= (uint64_t)read_u32(p) * PRIME64_1;
+        hash = rotate_left(hash, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash ^= *p * PRIME64_5;
+        hash = rotate_left(hash, 11) * PRIME64_1;
+    }
+
+    /* Avalanche so that every input bit affects every output bit */
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
     return hash;
 }
 
+/// @brief  Hash a memory buffer in one go.
+static inline uint64_t
+_easy_hash(void const *const buffer, size_t const size, uint64_t const seed)
+{
+    struct EasyHashState state = EasyHashState__new(seed);
+    EasyHashState__update(&state, buffer, size);
+    return EasyHashState__digest(&state);
+}
+
+/*******************************************************************************
+ *  OBJECTS
+ ******************************************************************************/
+
 /// @note   We need to be smart about this. It we do this naively, then
 ///         our hash value will depend on the order of the elements
-///         rather than the actual elements.
+///         rather than the actual elements. Instead, the table keeps a running
+///         sum of its items' entry hashes (i.e. a multiset hash), which we
+///         only need to finalize.
+/// Source: Clarke et al., "Incremental Multiset Hash Functions and Their
+///         Application to Memory Integrity Checking" (2003)
 static inline uint64_t
 EasyTable__hash(struct EasyTable const *const me)
 {
     EASY_GUARD(me != NULL, "me should not be NULL");
-    uint64_t hash = 0;
-    for (size_t i = 0; i < me->length; ++i) {
-        if (me->data[i].valid == EASY_TABLE_VALID) {
-            uint64_t key_hash = EasyGenericObject__hash(&me->data[i].key);
-            uint64_t val_hash = EasyGenericObject__hash(&me->data[i].value);
-            // NOTE This is probably really weak for a hash function but we want
-            // to make it consistent even if the key-value pairs are scrambled.
-            uint64_t obj_hash =
-                _djb2_hash(&key_hash, sizeof(key_hash), val_hash);
-            hash += obj_hash;
-        }
-    }
-    return hash;
+    struct EasyHashState state = EasyHashState__new(EasyHash__seed());
+    EasyHashState__update(&state, &me->length, sizeof(me->length));
+    EasyHashState__update(&state, &me->hash_sum, sizeof(me->hash_sum));
+    return EasyHashState__digest(&state);
 }
 
 static inline uint64_t
 EasyList__hash(struct EasyList const *const me)
 {
     EASY_GUARD(me != NULL, "me should not be NULL");
-    uint64_t hash =
-        _djb2_hash(&me->length, sizeof(me->length), DJB2_INITIAL_SEED);
+    uint64_t const memo = __atomic_load_n(&me->hash, __ATOMIC_RELAXED);
+    if (memo != 0) {
+        return memo;
+    }
+    struct EasyHashState state = EasyHashState__new(EasyHash__seed());
+    EasyHashState__update(&state, &me->length, sizeof(me->length));
     for (size_t i = 0; i < me->length; ++i) {
-        uint64_t obj_hash = EasyGenericObject__hash(&me->data[i]);
-        hash = _djb2_hash(&obj_hash, sizeof(obj_hash), hash);
+        uint64_t obj_hash = EasyGenericObject__hash(EasyList__get(me, i));
+        EasyHashState__update(&state, &obj_hash, sizeof(obj_hash));
+    }
+    uint64_t const hash = EasyHashState__digest(&state);
+    /* See EasyText__hash. The empty list is cheap to hash and may well be a
+     * static constant, so we leave it alone. */
+    if (me->length != 0) {
+        __atomic_store_n(
+            &((struct EasyList *)me)->hash, hash, __ATOMIC_RELAXED);
     }
     return hash;
 }
@@ -69,9 +249,22 @@ static inline uint64_t
 EasyText__hash(struct EasyText const *const me)
 {
     EASY_GUARD(me != NULL, "me should not be NULL");
-    uint64_t hash =
-        _djb2_hash(&me->length, sizeof(me->length), DJB2_INITIAL_SEED);
-    hash = _djb2_hash(me->data, me->length, hash);
+    uint64_t const memo = __atomic_load_n(&me->hash, __ATOMIC_RELAXED);
+    if (memo != 0) {
+        return memo;
+    }
+    struct EasyHashState state = EasyHashState__new(EasyHash__seed());
+    EasyHashState__update(&state, &me->length, sizeof(me->length));
+    /* Small and large texts hash the same characters alike */
+    EasyHashState__update(&state, EasyText__get_data(me), me->length);
+    uint64_t const hash = EasyHashState__digest(&state);
+    /* The memo is a cache rather than part of the value, so we may fill it in
+     * through a const pointer. The text is immutable, so the memo never goes
+     * stale, and copies carry it along. (A hash of zero is never memoised,
+     * but that only costs a recomputation.) Other threads may hash the same
+     * text at once, so we store the memo atomically; they all store the same
+     * value, so no ordering is needed. */
+    __atomic_store_n(&((struct EasyText *)me)->hash, hash, __ATOMIC_RELAXED);
     return hash;
 }
 
@@ -79,9 +272,23 @@ static inline uint64_t
 EasyInteger__hash(struct EasyInteger const *const me)
 {
     EASY_GUARD(me != NULL, "me should not be NULL");
-    uint64_t hash =
-        _djb2_hash(&me->length, sizeof(me->length), DJB2_INITIAL_SEED);
-    hash = _djb2_hash(me->data, me->length, hash);
+    uint64_t const memo = __atomic_load_n(&me->hash, __ATOMIC_RELAXED);
+    if (memo != 0) {
+        return memo;
+    }
+    struct EasyHashState state = EasyHashState__new(EasyHash__seed());
+    EasyHashState__update(&state, &me->sign, sizeof(me->sign));
+    /* Integers are canonical, so a small value never equals a large one. Small
+     * values are cheap to hash and may well be static constants, so we only
+     * memoise the hashes of large ones (see EasyText__hash). */
+    if (me->data == NULL) {
+        EasyHashState__update(&state, &me->small, sizeof(me->small));
+        return EasyHashState__digest(&state);
+    }
+    EasyHashState__update(&state, &me->length, sizeof(me->length));
+    EasyHashState__update(&state, me->data, me->length * sizeof(*me->data));
+    uint64_t const hash = EasyHashState__digest(&state);
+    __atomic_store_n(&((struct EasyInteger *)me)->hash, hash, __ATOMIC_RELAXED);
     return hash;
 }
 
@@ -98,7 +305,7 @@ static inline uint64_t
 EasyBoolean__hash(enum EasyBoolean const *const me)
 {
     EASY_GUARD(me != NULL, "me should not be NULL");
-    uint64_t hash = _djb2_hash(me, sizeof(*me), DJB2_INITIAL_SEED);
+    uint64_t hash = _easy_hash(me, sizeof(*me), EasyHash__seed());
     return hash;
 }
 
@@ -106,7 +313,7 @@ static inline uint64_t
 EasyNothing__hash(EasyNothing const *const me)
 {
     EASY_GUARD(me != NULL, "me should not be NULL");
-    uint64_t hash = _djb2_hash(me, sizeof(*me), DJB2_INITIAL_SEED);
+    uint64_t hash = _easy_hash(me, sizeof(*me), EasyHash__seed());
     return hash;
 }
 
@@ -114,42 +321,36 @@ uint64_t
 EasyGenericObject__hash(struct EasyGenericObject const *const me)
 {
     EASY_GUARD(me != NULL, "me should not be NULL");
-    uint64_t hash = _djb2_hash(&me->type, sizeof(me->type), DJB2_INITIAL_SEED);
+    struct EasyHashState state = EasyHashState__new(EasyHash__seed());
+    EasyHashState__update(&state, &me->type, sizeof(me->type));
     uint64_t obj_hash = 0;
     switch (me->type) {
     case EASY_TABLE_TYPE:
         obj_hash = EasyTable__hash(&me->data.table);
-        hash = _djb2_hash(&obj_hash, sizeof(obj_hash), hash);
         break;
     case EASY_LIST_TYPE:
         obj_hash = EasyList__hash(&me->data.list);
-        hash = _djb2_hash(&obj_hash, sizeof(obj_hash), hash);
         break;
     case EASY_TEXT_TYPE:
         obj_hash = EasyText__hash(&me->data.text);
-        hash = _djb2_hash(&obj_hash, sizeof(obj_hash), hash);
         break;
     case EASY_INTEGER_TYPE:
         obj_hash = EasyInteger__hash(&me->data.integer);
-        hash = _djb2_hash(&obj_hash, sizeof(obj_hash), hash);
         break;
     case EASY_FRACTION_TYPE:
         obj_hash = EasyFraction__hash(&me->data.fraction);
-        hash = _djb2_hash(&obj_hash, sizeof(obj_hash), hash);
         break;
     case EASY_BOOLEAN_TYPE:
         obj_hash = EasyBoolean__hash(&me->data.boolean);
-        hash = _djb2_hash(&obj_hash, sizeof(obj_hash), hash);
         break;
     case EASY_NOTHING_TYPE:
         obj_hash = EasyNothing__hash(&me->data.nothing);
-        hash = _djb2_hash(&obj_hash, sizeof(obj_hash), hash);
         break;
     default:
         EASY_IMPOSSIBLE();
     }
-
-    return hash;
+    EasyHashState__update(&state, &obj_hash, sizeof(obj_hash));
+    return EasyHashState__digest(&state);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -159,10 +360,65 @@ EasyGenericObject__hash(struct EasyGenericObject const *const me)
 #include "common/easy_test.h"
 #include "common/easy_unused.h"
 
+static struct EasyGenericObject
+new_integer_object(int const value)
+{
+    char str[16] = {0};
+    snprintf(str, sizeof(str), "%d", value);
+    return (struct EasyGenericObject){
+        .type = EASY_INTEGER_TYPE,
+        .data = {.integer = EasyInteger__from_cstr(str)}};
+}
+
+/// @brief  Insert {key: value} into the table, replacing the table.
+static void
+insert_integers(struct EasyTable *const me, int const key, int const value)
+{
+    struct EasyGenericObject k = new_integer_object(key);
+    struct EasyGenericObject v = new_integer_object(value);
+    struct EasyTable table = EasyTable__insert(me, &k, &v);
+    EasyTable__destroy(me);
+    *me = table;
+    EasyGenericObject__destroy(&k);
+    EasyGenericObject__destroy(&v);
+}
+
 static bool
 test_hash_easy_table(void)
 {
-    EASY_NOT_IMPLEMENTED();
+    int const num_keys = 100;
+    struct EasyTable forward = EasyTable__new_empty();
+    struct EasyTable backward = EasyTable__new_empty();
+    struct EasyTable without_7 = EasyTable__new_empty();
+    for (int i = 0; i < num_keys; ++i) {
+        insert_integers(&forward, i, 2 * i);
+        insert_integers(&backward, num_keys - 1 - i, 2 * (num_keys - 1 - i));
+        if (i != 7) {
+            insert_integers(&without_7, i, 2 * i);
+        }
+    }
+    /* The order of insertion does not matter */
+    uint64_t const hash = EasyTable__hash(&forward);
+    EASY_TEST_ASSERT_UINTCMP(hash, ==, EasyTable__hash(&backward));
+
+    /* Replacing a value changes the hash, and restoring it restores the hash */
+    insert_integers(&backward, 5, -1);
+    EASY_TEST_ASSERT_UINTCMP(hash, !=, EasyTable__hash(&backward));
+    insert_integers(&backward, 5, 10);
+    EASY_TEST_ASSERT_UINTCMP(hash, ==, EasyTable__hash(&backward));
+
+    /* Removing an item subtracts its entry hash */
+    struct EasyGenericObject key = new_integer_object(7);
+    struct EasyTable removed = EasyTable__remove(&forward, &key);
+    EASY_TEST_ASSERT_UINTCMP(
+        EasyTable__hash(&removed), ==, EasyTable__hash(&without_7));
+    EASY_TEST_ASSERT_UINTCMP(hash, !=, EasyTable__hash(&removed));
+
+    EasyGenericObject__destroy(&key);
+    EasyTable__destroy(&forward);
+    EasyTable__destroy(&backward);
+    EasyTable__destroy(&without_7);
+    EasyTable__destroy(&removed);
     return true;
 }
 
@@ -256,6 +512,62 @@ test_hash_easy_nothing(void)
     return true;
 }
 
+static bool
+test_hash_state(void)
+{
+    /* Reference values for XXH64 with a seed of zero */
+    struct EasyHashState empty = EasyHashState__new(0);
+    EASY_TEST_ASSERT_UINTCMP(
+        EasyHashState__digest(&empty), ==, 0xEF46DB3751D8E999ULL);
+    EASY_TEST_ASSERT_UINTCMP(
+        _easy_hash("abc", 3, 0), ==, 0x44BC2CF5AD770999ULL);
+
+    /* We get the same hash no matter how we split up the buffer */
+    unsigned char buffer[100] = {0};
+    for (size_t i = 0; i < sizeof(buffer); ++i) {
+        buffer[i] = (unsigned char)(i * 37);
+    }
+    uint64_t const seed = EasyHash__seed();
+    uint64_t const expected = _easy_hash(buffer, sizeof(buffer), seed);
+    for (size_t piece = 1; piece <= 40; ++piece) {
+        struct EasyHashState state = EasyHashState__new(seed);
+        for (size_t i = 0; i < sizeof(buffer); i += piece) {
+            size_t const size = MIN(piece, sizeof(buffer) - i);
+            EasyHashState__update(&state, &buffer[i], size);
+        }
+        EASY_TEST_ASSERT_UINTCMP(EasyHashState__digest(&state), ==, expected);
+    }
+    return true;
+}
+
+static bool
+test_hash_memo(void)
+{
+    struct EasyGenericObject text = {
+        .type = EASY_TEXT_TYPE,
+        .data = {.text = EasyText__from_cstr("Hello, World!")}};
+    struct EasyList empty = EasyList__new_empty();
+    struct EasyList list = EasyList__append(&empty, &text);
+    EASY_TEST_ASSERT_UINTCMP(list.hash, ==, 0);
+
+    /* We memoise the hash the first time, and copies carry it along */
+    uint64_t const hash = EasyList__hash(&list);
+    EASY_TEST_ASSERT_UINTCMP(list.hash, ==, hash);
+    struct EasyList copy = EasyList__copy(&list);
+    EASY_TEST_ASSERT_UINTCMP(copy.hash, ==, hash);
+
+    /* A fresh, equal list computes the same hash from scratch */
+    struct EasyList other = EasyList__append(&empty, &text);
+    EASY_TEST_ASSERT_UINTCMP(EasyList__hash(&other), ==, hash);
+
+    EasyGenericObject__destroy(&text);
+    EasyList__destroy(&empty);
+    EasyList__destroy(&list);
+    EasyList__destroy(&copy);
+    EasyList__destroy(&other);
+    return true;
+}
+
 bool
 test_easy_hash(void)
 {
@@ -269,10 +581,12 @@ test_easy_hash(void)
     EASY_MAYBE_UNUSED(test_hash_easy_nothing);
 
 // Run tests
+    EASY_TEST_SUCCESS(test_hash_easy_table());
 #if 0
-  EASY_TEST_SUCCESS(test_hash_easy_table());
   EASY_TEST_SUCCESS(test_hash_easy_list());
 #endif
+    EASY_TEST_SUCCESS(test_hash_state());
+    EASY_TEST_SUCCESS(test_hash_memo());
     EASY_TEST_SUCCESS(test_hash_easy_text());
     EASY_TEST_SUCCESS(test_hash_easy_integer());
 #if 0
@@ -1,10 +1,42 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "easy_lib.h"
 
+/* EasyHashState
+ * This hashes a stream of bytes with XXH64, which consumes 32 bytes per step
+ * in four independent lanes. Feeding a buffer in pieces gives the same hash as
+ * feeding it all at once.
+ */
+struct EasyHashState {
+    uint64_t lanes[4];
+    uint64_t seed;
+    uint64_t total_length;
+    unsigned char buffer[32]; /* The bytes that do not yet fill a stripe */
+    size_t buffer_length;
+};
+
+/// @brief  Get this process's random seed. We read it from /dev/urandom on
+///         the first call, unless the EASY_HASH_SEED environment variable sets
+///         it (e.g. to reproduce a run).
+uint64_t
+EasyHash__seed(void);
+struct EasyHashState
+EasyHashState__new(uint64_t const seed);
+void
+EasyHashState__update(struct EasyHashState *const me,
+                      void const *const buffer,
+                      size_t const size);
+uint64_t
+EasyHashState__digest(struct EasyHashState const *const me);
+
+/// @brief  Hash an object. We memoise the hashes of large texts, integers,
+///         and lists in the object itself, even through a const pointer.
+/// @note   We read and write the memos with relaxed atomics, so several
+///         threads may hash (or compare, or copy) one object at once.
 uint64_t
 EasyGenericObject__hash(struct EasyGenericObject const *const me);
 
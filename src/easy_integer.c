@@ -1,281 +1,1821 @@
 /* EasyInteger */
 
 #include <ctype.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "easy_arena.h"
 #include "easy_common.h"
 
 #include "easy_integer.h"
 
+/* We need a double-width limb to hold the carries. */
+__extension__ typedef unsigned __int128 EasyDoubleLimb;
+__extension__ typedef __int128 EasySignedDoubleLimb;
+
+#define LIMB_BITS 64
+/* The largest power of ten that fits in a limb; we convert to and from decimal
+ * in chunks of this many digits. */
+#define DECIMAL_CHUNK_BASE   10000000000000000000ULL
+#define DECIMAL_CHUNK_DIGITS 19
+
+/*******************************************************************************
+ *  LIMB ARITHMETIC
+ ******************************************************************************/
+
+/// @brief  Allocate an integer with room for the given number of limbs. The
+///         limbs start as zero.
+static struct EasyInteger
+new_integer(enum EasyIntegerSign const sign, size_t const capacity)
+{
+    /* We always allocate a buffer, even for small values, so that limb
+     * integers are never mistaken for small ones until we canonicalize them */
+    uint64_t *data = EASY_SHARED_ALLOC(MAX(capacity, (size_t)1), sizeof(*data));
+    memset(data, 0, MAX(capacity, (size_t)1) * sizeof(*data));
+    return (struct EasyInteger){.sign = sign, .data = data, .length = capacity};
+}
+
+/// @brief  Strip the leading zero limbs to restore the canonical form.
+static void
+normalize(struct EasyInteger *const me)
+{
+    while (me->length > 0 && me->data[me->length - 1] == 0) {
+        --me->length;
+    }
+    if (me->length == 0) {
+        me->sign = ZERO;
+    }
+}
+
+/// @brief  Compare the magnitudes of two canonical integers.
+static int
+compare_magnitude(struct EasyInteger const *const a,
+                  struct EasyInteger const *const b)
+{
+    if (a->length != b->length) {
+        return a->length > b->length ? 1 : -1;
+    }
+    /* Starting from the most significant limb, work backwards until we find a
+     * difference */
+    for (size_t i = a->length; i > 0; --i) {
+        if (a->data[i - 1] != b->data[i - 1]) {
+            return a->data[i - 1] > b->data[i - 1] ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+/// @brief  Set out = |a| + |b|. The output must have room for
+///         MAX(a->length, b->length) + 1 limbs.
+static void
+add_magnitude(uint64_t *const out,
+              struct EasyInteger const *const a,
+              struct EasyInteger const *const b)
+{
+    size_t const length = MAX(a->length, b->length);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < length; ++i) {
+        EasyDoubleLimb const sum = (EasyDoubleLimb)carry +
+                                   (i < a->length ? a->data[i] : 0) +
+                                   (i < b->length ? b->data[i] : 0);
+        out[i] = (uint64_t)sum;
+        carry = (uint64_t)(sum >> LIMB_BITS);
+    }
+    out[length] = carry;
+}
+
+/// @brief  Set out = |a| - |b|, where |a| >= |b|. The output must have room
+///         for a->length limbs.
+static void
+subtract_magnitude(uint64_t *const out,
+                   struct EasyInteger const *const a,
+                   struct EasyInteger const *const b)
+{
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < a->length; ++i) {
+        uint64_t const b_ = i < b->length ? b->data[i] : 0;
+        uint64_t const diff = a->data[i] - b_ - borrow;
+        borrow = (a->data[i] < b_) || (a->data[i] - b_ < borrow);
+        out[i] = diff;
+    }
+    EASY_ASSERT(borrow == 0, "the first magnitude must be the larger");
+}
+
+/// @brief  Set limbs = limbs * factor + addend in place, returning the carry.
+static uint64_t
+multiply_add_limb(uint64_t *const limbs,
+                  size_t const length,
+                  uint64_t const factor,
+                  uint64_t const addend)
+{
+    uint64_t carry = addend;
+    for (size_t i = 0; i < length; ++i) {
+        EasyDoubleLimb const product =
+            (EasyDoubleLimb)limbs[i] * factor + carry;
+        limbs[i] = (uint64_t)product;
+        carry = (uint64_t)(product >> LIMB_BITS);
+    }
+    return carry;
+}
+
+/// @brief  Set limbs = limbs / divisor in place, returning the remainder.
+static uint64_t
+divide_limb(uint64_t *const limbs, size_t const length, uint64_t const divisor)
+{
+    uint64_t remainder = 0;
+    for (size_t i = length; i > 0; --i) {
+        EasyDoubleLimb const dividend =
+            ((EasyDoubleLimb)remainder << LIMB_BITS) | limbs[i - 1];
+        limbs[i - 1] = (uint64_t)(dividend / divisor);
+        remainder = (uint64_t)(dividend % divisor);
+    }
+    return remainder;
+}
+
+/// @brief  Borrow the magnitude of limbs [start, start + count) as a canonical
+///         integer. The view shares the buffer, so it must not outlive it and
+///         must not be copied or destroyed.
+static struct EasyInteger
+new_view(struct EasyInteger const *const me, size_t start, size_t count)
+{
+    start = MIN(start, me->length);
+    count = MIN(count, me->length - start);
+    struct EasyInteger view = {
+        .sign = POSITIVE,
+        .data = &me->data[start],
+        .length = count,
+    };
+    normalize(&view);
+    return view;
+}
+
+/// @brief  Borrow an integer with the opposite sign (see new_view).
+static struct EasyInteger
+new_negated_view(struct EasyInteger const *const me)
+{
+    struct EasyInteger view = *me;
+    view.sign = -me->sign;
+    view.hash = 0;
+    return view;
+}
+
+/// @brief  Add two integers into a new buffer. Unlike EasyInteger__add, this
+///         never shares a buffer with its inputs, so the inputs may be views.
+static struct EasyInteger
+add_integers(struct EasyInteger const *const a,
+             struct EasyInteger const *const b)
+{
+    if (a->sign == ZERO || b->sign == ZERO || a->sign == b->sign) {
+        enum EasyIntegerSign const sign = a->sign == ZERO ? b->sign : a->sign;
+        struct EasyInteger me =
+            new_integer(sign, MAX(a->length, b->length) + 1);
+        add_magnitude(me.data, a, b);
+        normalize(&me);
+        return me;
+    }
+    int const cmp = compare_magnitude(a, b);
+    if (cmp == 0) {
+        return new_integer(ZERO, 0);
+    }
+    struct EasyInteger const *const larger_int = cmp > 0 ? a : b;
+    struct EasyInteger const *const smaller_int = cmp > 0 ? b : a;
+    struct EasyInteger me = new_integer(larger_int->sign, larger_int->length);
+    subtract_magnitude(me.data, larger_int, smaller_int);
+    normalize(&me);
+    return me;
+}
+
+static struct EasyInteger
+subtract_integers(struct EasyInteger const *const a,
+                  struct EasyInteger const *const b)
+{
+    struct EasyInteger const negated_b = new_negated_view(b);
+    return add_integers(a, &negated_b);
+}
+
+/// @brief  Copy an integer into a new buffer (the input may be a view).
+static struct EasyInteger
+duplicate_integer(struct EasyInteger const *const me)
+{
+    struct EasyInteger copy = new_integer(me->sign, me->length);
+    memcpy(copy.data, me->data, me->length * sizeof(*me->data));
+    return copy;
+}
+
+/// @brief  Divide an integer by a small divisor that is known to divide it.
+///         We take ownership of the integer (which must own its limbs), so we
+///         only copy the limbs if another integer shares them.
+static struct EasyInteger
+divide_exact(struct EasyInteger *const me, uint64_t const divisor)
+{
+    struct EasyInteger quotient = *me;
+    quotient.hash = 0;
+    if (!EASY_SHARED_IS_UNIQUE(me->data)) {
+        quotient = duplicate_integer(me);
+        EasyInteger__destroy(me);
+    }
+    *me = (struct EasyInteger){0};
+    uint64_t const remainder =
+        divide_limb(quotient.data, quotient.length, divisor);
+    EASY_ASSERT(remainder == 0, "the division must be exact");
+    normalize(&quotient);
+    return quotient;
+}
+
+/// @brief  Add a non-negative integer into a limb buffer at a limb offset.
+static void
+add_shifted(uint64_t *const out,
+            size_t const out_length,
+            struct EasyInteger const *const x,
+            size_t const shift)
+{
+    EASY_ASSERT(x->sign != NEGATIVE, "we can only add non-negative values");
+    EASY_ASSERT(shift + x->length <= out_length, "the value must fit");
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i < x->length; ++i) {
+        EasyDoubleLimb const sum =
+            (EasyDoubleLimb)out[shift + i] + x->data[i] + carry;
+        out[shift + i] = (uint64_t)sum;
+        carry = (uint64_t)(sum >> LIMB_BITS);
+    }
+    for (i += shift; carry != 0; ++i) {
+        EASY_ASSERT(i < out_length, "the sum must fit");
+        carry = ++out[i] == 0;
+    }
+}
+
+/*******************************************************************************
+ *  SMALL VALUES
+ ******************************************************************************/
+
+static struct EasyInteger
+new_small(int64_t const value)
+{
+    return (struct EasyInteger){
+        .sign = value < 0 ? NEGATIVE : value > 0 ? POSITIVE : ZERO,
+        .data = NULL,
+        .length = 0,
+        .small = value,
+    };
+}
+
+/// @brief  Borrow the limbs of an integer (see new_view). A small value has no
+///         limbs of its own, so it borrows the caller's limb.
+static struct EasyInteger
+new_limb_view(struct EasyInteger const *const me, uint64_t *const limb)
+{
+    if (me->data != NULL) {
+        return *me;
+    }
+    /* We negate in unsigned arithmetic so that INT64_MIN does not overflow */
+    *limb = me->small < 0 ? 0 - (uint64_t)me->small : (uint64_t)me->small;
+    return (struct EasyInteger){.sign = me->sign,
+                                .data = limb,
+                                .length = me->sign != ZERO};
+}
+
+/// @brief  Move a value that fits in an int64_t inline, freeing its limbs.
+static struct EasyInteger
+canonicalize(struct EasyInteger me)
+{
+    EASY_ASSERT(me.data != NULL, "we can only canonicalize limb integers");
+    if (me.length > 1) {
+        return me;
+    }
+    uint64_t const magnitude = me.length == 1 ? me.data[0] : 0;
+    uint64_t const max_magnitude =
+        me.sign == NEGATIVE ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+    if (magnitude > max_magnitude) {
+        return me;
+    }
+    enum EasyIntegerSign const sign = me.sign;
+    EasyInteger__destroy(&me);
+    if (sign == NEGATIVE) {
+        return new_small(-(int64_t)(magnitude - 1) - 1);
+    }
+    return new_small((int64_t)magnitude);
+}
+
+/*******************************************************************************
+ *  MULTIPLICATION
+ ******************************************************************************/
+
+/* Splitting shorter operands would not make the subproblems any smaller */
+#define MIN_SPLIT_LENGTH 4
+
+size_t EasyInteger__karatsuba_threshold = EASY_INTEGER_KARATSUBA_THRESHOLD;
+size_t EasyInteger__toom3_threshold = EASY_INTEGER_TOOM3_THRESHOLD;
+size_t EasyInteger__ntt_threshold = EASY_INTEGER_NTT_THRESHOLD;
+
+static struct EasyInteger
+multiply_integers(struct EasyInteger const *const a,
+                  struct EasyInteger const *const b);
+
+/// @brief  Schoolbook multiplication, which is O(n * m).
+static void
+multiply_basecase(struct EasyInteger *const me,
+                  struct EasyInteger const *const a,
+                  struct EasyInteger const *const b)
+{
+    for (size_t i = 0; i < a->length; ++i) {
+        /* The product of two limbs plus two more limbs never overflows */
+        uint64_t carry = 0;
+        for (size_t j = 0; j < b->length; ++j) {
+            EasyDoubleLimb const product =
+                (EasyDoubleLimb)a->data[i] * b->data[j] + me->data[i + j] +
+                carry;
+            me->data[i + j] = (uint64_t)product;
+            carry = (uint64_t)(product >> LIMB_BITS);
+        }
+        me->data[i + b->length] = carry;
+    }
+}
+
+/// @brief  Multiply by splitting the longer operand into pieces as long as
+///         the shorter one, so that each partial product is balanced.
+static void
+multiply_unbalanced(struct EasyInteger *const me,
+                    struct EasyInteger const *const a,
+                    struct EasyInteger const *const b)
+{
+    struct EasyInteger const b_ = new_view(b, 0, b->length);
+    for (size_t i = 0; i < a->length; i += b->length) {
+        struct EasyInteger const piece = new_view(a, i, b->length);
+        struct EasyInteger product = multiply_integers(&piece, &b_);
+        add_shifted(me->data, me->length, &product, i);
+        EasyInteger__destroy(&product);
+    }
+}
+
+/// @brief  Karatsuba multiplication, which is O(n^1.585). We split each
+///         operand in half and make three half-sized products:
+///             (a1 x + a0)(b1 x + b0) = z2 x^2 + z1 x + z0, where
+///             z1 = (a0 + a1)(b0 + b1) - z0 - z2.
+/// Source: Knuth, TAOCP Vol. 2, Section 4.3.3.A
+static void
+multiply_karatsuba(struct EasyInteger *const me,
+                   struct EasyInteger const *const a,
+                   struct EasyInteger const *const b)
+{
+    size_t const half = (a->length + 1) / 2;
+    struct EasyInteger const a0 = new_view(a, 0, half);
+    struct EasyInteger const a1 = new_view(a, half, a->length);
+    struct EasyInteger const b0 = new_view(b, 0, half);
+    struct EasyInteger const b1 = new_view(b, half, b->length);
+
+    struct EasyInteger z0 = multiply_integers(&a0, &b0);
+    struct EasyInteger z2 = multiply_integers(&a1, &b1);
+    struct EasyInteger a_sum = add_integers(&a0, &a1);
+    struct EasyInteger b_sum = add_integers(&b0, &b1);
+    struct EasyInteger z1 = multiply_integers(&a_sum, &b_sum);
+    struct EasyInteger tmp = subtract_integers(&z1, &z0);
+    EasyInteger__destroy(&z1);
+    z1 = subtract_integers(&tmp, &z2);
+
+    add_shifted(me->data, me->length, &z0, 0);
+    add_shifted(me->data, me->length, &z1, half);
+    add_shifted(me->data, me->length, &z2, 2 * half);
+
+    EasyInteger__destroy(&z0);
+    EasyInteger__destroy(&z1);
+    EasyInteger__destroy(&z2);
+    EasyInteger__destroy(&a_sum);
+    EasyInteger__destroy(&b_sum);
+    EasyInteger__destroy(&tmp);
+}
+
+/// @brief  Evaluate (p2 x^2 + p1 x + p0) at x = 0, 1, -1, -2, and infinity.
+static void
+evaluate_toom3(struct EasyInteger *const values,
+               struct EasyInteger const *const p0,
+               struct EasyInteger const *const p1,
+               struct EasyInteger const *const p2)
+{
+    struct EasyInteger even = add_integers(p0, p2);
+    values[0] = duplicate_integer(p0);
+    values[1] = add_integers(&even, p1);
+    values[2] = subtract_integers(&even, p1);
+    /* p(-2) = 2 (p(-1) + p2) - p0 */
+    struct EasyInteger tmp = add_integers(&values[2], p2);
+    struct EasyInteger twice = add_integers(&tmp, &tmp);
+    values[3] = subtract_integers(&twice, p0);
+    values[4] = duplicate_integer(p2);
+    EasyInteger__destroy(&even);
+    EasyInteger__destroy(&tmp);
+    EasyInteger__destroy(&twice);
+}
+
+/// @brief  Toom-Cook 3-way multiplication, which is O(n^1.465). We split each
+///         operand into thirds, evaluate the polynomials at five points, make
+///         five third-sized products, and interpolate.
+/// Source: Bodrato, "Towards Optimal Toom-Cook Multiplication for Univariate
+///         and Multivariate Polynomials in Characteristic 2 and 0" (2007)
+static void
+multiply_toom3(struct EasyInteger *const me,
+               struct EasyInteger const *const a,
+               struct EasyInteger const *const b)
+{
+    size_t const third = (a->length + 2) / 3;
+    struct EasyInteger const a0 = new_view(a, 0, third);
+    struct EasyInteger const a1 = new_view(a, third, third);
+    struct EasyInteger const a2 = new_view(a, 2 * third, a->length);
+    struct EasyInteger const b0 = new_view(b, 0, third);
+    struct EasyInteger const b1 = new_view(b, third, third);
+    struct EasyInteger const b2 = new_view(b, 2 * third, b->length);
+
+    struct EasyInteger a_values[5] = {0}, b_values[5] = {0}, v[5] = {0};
+    evaluate_toom3(a_values, &a0, &a1, &a2);
+    evaluate_toom3(b_values, &b0, &b1, &b2);
+    for (size_t i = 0; i < 5; ++i) {
+        v[i] = multiply_integers(&a_values[i], &b_values[i]);
+        EasyInteger__destroy(&a_values[i]);
+        EasyInteger__destroy(&b_values[i]);
+    }
+
+    /* Interpolate the coefficients r0..r4 from v(0), v(1), v(-1), v(-2), and
+     * v(inf), following Bodrato's sequence. */
+    struct EasyInteger tmp = {0}, tmp2 = {0};
+    tmp = subtract_integers(&v[3], &v[1]);
+    struct EasyInteger r3 = divide_exact(&tmp, 3);
+    tmp = subtract_integers(&v[1], &v[2]);
+    struct EasyInteger r1 = divide_exact(&tmp, 2);
+    struct EasyInteger r2 = subtract_integers(&v[2], &v[0]);
+    tmp = subtract_integers(&r2, &r3);
+    tmp2 = divide_exact(&tmp, 2);
+    tmp = add_integers(&v[4], &v[4]);
+    EasyInteger__destroy(&r3);
+    r3 = add_integers(&tmp2, &tmp);
+    EasyInteger__destroy(&tmp);
+    EasyInteger__destroy(&tmp2);
+    tmp = add_integers(&r2, &r1);
+    EasyInteger__destroy(&r2);
+    r2 = subtract_integers(&tmp, &v[4]);
+    EasyInteger__destroy(&tmp);
+    tmp = subtract_integers(&r1, &r3);
+    EasyInteger__destroy(&r1);
+    r1 = tmp;
+
+    add_shifted(me->data, me->length, &v[0], 0);
+    add_shifted(me->data, me->length, &r1, third);
+    add_shifted(me->data, me->length, &r2, 2 * third);
+    add_shifted(me->data, me->length, &r3, 3 * third);
+    add_shifted(me->data, me->length, &v[4], 4 * third);
+
+    for (size_t i = 0; i < 5; ++i) {
+        EasyInteger__destroy(&v[i]);
+    }
+    EasyInteger__destroy(&r1);
+    EasyInteger__destroy(&r2);
+    EasyInteger__destroy(&r3);
+}
+
+/*******************************************************************************
+ *  NUMBER THEORETIC TRANSFORM
+ ******************************************************************************/
+
+/* We multiply huge operands by convolving their 32-bit halves with number
+ * theoretic transforms (NTTs) modulo three primes of the form c * 2^k + 1,
+ * then reconstruct each coefficient with the Chinese remainder theorem (CRT).
+ * A coefficient of the convolution is below min(n, m) * 2^64, where n and m
+ * are the numbers of halves, so it fits below the product of the primes
+ * (~2^85.99) as long as min(n, m) <= 2^21. */
+#define NTT_NUM_PRIMES        3
+#define NTT_MAX_LENGTH        ((size_t)1 << 23) /* 998244353 = 119 * 2^23 + 1 */
+#define NTT_MAX_SHORTER_HALVES ((size_t)1 << 21)
+#define HALF_LIMB_BITS        32
+#define HALF_LIMB_MASK        0xFFFFFFFFu
+
+/* We do arithmetic modulo each prime in Montgomery form with R = 2^32, which
+ * replaces the division in each modular multiplication with two multiplies.
+ * Source: Montgomery, "Modular Multiplication Without Trial Division" (1985)
+ */
+struct NttPrime {
+    uint32_t modulus;
+    uint32_t generator;   /* A primitive root */
+    uint32_t neg_inverse; /* -modulus^-1 mod 2^32 */
+    uint32_t r_squared;   /* R^2 mod modulus, to convert into Montgomery form */
+};
+
+static uint32_t const ntt_moduli[NTT_NUM_PRIMES] = {
+    998244353, /* 119 * 2^23 + 1 */
+    167772161, /* 5 * 2^25 + 1 */
+    469762049, /* 7 * 2^26 + 1 */
+};
+
+static struct NttPrime
+new_ntt_prime(uint32_t const modulus)
+{
+    /* Newton's iteration doubles the number of correct bits each time */
+    uint32_t inverse = modulus;
+    for (size_t i = 0; i < 5; ++i) {
+        inverse *= 2 - modulus * inverse;
+    }
+    uint64_t const r = ((uint64_t)1 << 32) % modulus;
+    return (struct NttPrime){
+        .modulus = modulus,
+        .generator = 3,
+        .neg_inverse = -inverse,
+        .r_squared = (uint32_t)(r * r % modulus),
+    };
+}
+
+/// @brief  Get t / R mod p, where t < p * 2^32.
+static inline uint32_t
+montgomery_reduce(uint64_t const t, struct NttPrime const *const p)
+{
+    uint32_t const m = (uint32_t)t * p->neg_inverse;
+    uint32_t const u = (uint32_t)((t + (uint64_t)m * p->modulus) >> 32);
+    return u >= p->modulus ? u - p->modulus : u;
+}
+
+/// @brief  Get a * b / R mod p. If either is in Montgomery form (i.e. scaled
+///         by R), then the result is the plain product.
+static inline uint32_t
+montgomery_multiply(uint32_t const a,
+                    uint32_t const b,
+                    struct NttPrime const *const p)
+{
+    return montgomery_reduce((uint64_t)a * b, p);
+}
+
+static uint32_t
+to_montgomery(uint32_t const a, struct NttPrime const *const p)
+{
+    return montgomery_multiply(a % p->modulus, p->r_squared, p);
+}
+
+/// @brief  Raise a number in Montgomery form to a power, in Montgomery form.
+static uint32_t
+montgomery_pow(uint32_t base, uint64_t exponent, struct NttPrime const *const p)
+{
+    uint32_t result = to_montgomery(1, p);
+    for (; exponent != 0; exponent >>= 1) {
+        if (exponent & 1) {
+            result = montgomery_multiply(result, base, p);
+        }
+        base = montgomery_multiply(base, base, p);
+    }
+    return result;
+}
+
+/// @brief  Get the inverse of a modulo p (in plain form).
+static uint32_t
+invert_modulo(uint32_t const a, struct NttPrime const *const p)
+{
+    /* By Fermat's little theorem, a^(p - 2) = a^-1 mod p */
+    uint32_t const inverse =
+        montgomery_pow(to_montgomery(a, p), p->modulus - 2, p);
+    return montgomery_reduce(inverse, p);
+}
+
+/// @brief  Transform the values (in plain form, modulo p) in place. The length
+///         must be a power of two.
+/// Source: Cormen et al., "Introduction to Algorithms", Section 30.3
+static void
+ntt_transform(uint32_t *const values,
+              size_t const length,
+              bool const inverse,
+              struct NttPrime const *const prime)
+{
+    /* We copy the prime so that writing the values cannot alias it */
+    struct NttPrime const local_prime = *prime;
+    struct NttPrime const *const p = &local_prime;
+    /* Put the values into bit-reversed order */
+    for (size_t i = 1, j = 0; i < length; ++i) {
+        size_t bit = length >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            uint32_t const tmp = values[i];
+            values[i] = values[j];
+            values[j] = tmp;
+        }
+    }
+
+    /* Tabulate the powers of a primitive length-th root of unity, so that the
+     * butterflies do not wait on each other to compute their twiddles. */
+    uint32_t *twiddles = EASY_MALLOC(MAX(length / 2, (size_t)1),
+                                     sizeof(*twiddles));
+    uint64_t const order = (p->modulus - 1) / length;
+    uint32_t const root =
+        montgomery_pow(to_montgomery(p->generator, p),
+                       inverse ? (p->modulus - 1) - order : order,
+                       p);
+    twiddles[0] = to_montgomery(1, p);
+    for (size_t i = 1; i < length / 2; ++i) {
+        twiddles[i] = montgomery_multiply(twiddles[i - 1], root, p);
+    }
+
+    for (size_t width = 2; width <= length; width <<= 1) {
+        size_t const half = width / 2, stride = length / width;
+        for (size_t i = 0; i < length; i += width) {
+            for (size_t j = 0; j < half; ++j) {
+                uint32_t const u = values[i + j];
+                uint32_t const v = montgomery_multiply(values[i + j + half],
+                                                       twiddles[j * stride],
+                                                       p);
+                uint32_t const sum = u + v;
+                values[i + j] = sum >= p->modulus ? sum - p->modulus : sum;
+                values[i + j + half] = u >= v ? u - v : u + p->modulus - v;
+            }
+        }
+    }
+    EASY_FREE(twiddles);
+
+    if (inverse) {
+        uint32_t const scale =
+            to_montgomery(invert_modulo((uint32_t)(length % p->modulus), p),
+                          p);
+        for (size_t i = 0; i < length; ++i) {
+            values[i] = montgomery_multiply(values[i], scale, p);
+        }
+    }
+}
+
+static inline uint32_t
+get_half_limb(struct EasyInteger const *const me, size_t const i)
+{
+    return (uint32_t)(me->data[i / 2] >> (HALF_LIMB_BITS * (i % 2)));
+}
+
+/// @brief  Check whether the NTT can multiply operands of these lengths.
+static bool
+is_ntt_feasible(size_t const x_length, size_t const y_length)
+{
+    size_t const num_halves = 2 * (x_length + y_length);
+    return 2 * MIN(x_length, y_length) <= NTT_MAX_SHORTER_HALVES &&
+           num_halves <= NTT_MAX_LENGTH;
+}
+
+/// @brief  Convolve the operands modulo a prime, storing the residues.
+static void
+convolve_modulo(uint32_t *const residues,
+                uint32_t *const scratch,
+                size_t const length,
+                struct EasyInteger const *const a,
+                struct EasyInteger const *const b,
+                struct NttPrime const *const p)
+{
+    memset(residues, 0, length * sizeof(*residues));
+    memset(scratch, 0, length * sizeof(*scratch));
+    for (size_t i = 0; i < 2 * a->length; ++i) {
+        residues[i] = get_half_limb(a, i) % p->modulus;
+    }
+    for (size_t i = 0; i < 2 * b->length; ++i) {
+        scratch[i] = get_half_limb(b, i) % p->modulus;
+    }
+    ntt_transform(residues, length, false, p);
+    ntt_transform(scratch, length, false, p);
+    for (size_t i = 0; i < length; ++i) {
+        uint32_t const a_ = montgomery_multiply(residues[i], p->r_squared, p);
+        residues[i] = montgomery_multiply(a_, scratch[i], p);
+    }
+    ntt_transform(residues, length, true, p);
+}
+
+/// @brief  Multiply with three-prime NTTs, which is O(n log n).
+static void
+multiply_ntt(struct EasyInteger *const me,
+             struct EasyInteger const *const a,
+             struct EasyInteger const *const b)
+{
+    size_t const num_halves = 2 * (a->length + b->length);
+    size_t length = 1;
+    while (length < num_halves) {
+        length <<= 1;
+    }
+    struct NttPrime primes[NTT_NUM_PRIMES] = {{0}};
+    uint32_t *residues[NTT_NUM_PRIMES] = {0};
+    uint32_t *scratch = EASY_MALLOC(length, sizeof(*scratch));
+    for (size_t i = 0; i < NTT_NUM_PRIMES; ++i) {
+        primes[i] = new_ntt_prime(ntt_moduli[i]);
+        residues[i] = EASY_MALLOC(length, sizeof(*residues[i]));
+        convolve_modulo(residues[i], scratch, length, a, b, &primes[i]);
+    }
+
+    /* Reconstruct each coefficient with Garner's algorithm:
+     *  x = r0 + p0 * (t1 + p1 * t2), where t1 < p1 and t2 < p2. */
+    uint64_t const p0 = primes[0].modulus, p1 = primes[1].modulus,
+                   p2 = primes[2].modulus;
+    uint64_t const p0_inverse = invert_modulo((uint32_t)(p0 % p1), &primes[1]);
+    uint64_t const p01_inverse =
+        invert_modulo((uint32_t)(p0 * p1 % p2), &primes[2]);
+    EasyDoubleLimb carry = 0;
+    for (size_t i = 0; i < num_halves; ++i) {
+        uint64_t const r0 = residues[0][i], r1 = residues[1][i],
+                       r2 = residues[2][i];
+        uint64_t const t1 = (r1 + p1 - r0 % p1) % p1 * p0_inverse % p1;
+        uint64_t const x01 = r0 + p0 * t1; /* Below p0 * p1 < 2^60 */
+        uint64_t const t2 = (r2 + p2 - x01 % p2) % p2 * p01_inverse % p2;
+        carry += (EasyDoubleLimb)p0 * p1 * t2 + x01;
+        me->data[i / 2] |= (uint64_t)(carry & HALF_LIMB_MASK)
+                           << (HALF_LIMB_BITS * (i % 2));
+        carry >>= HALF_LIMB_BITS;
+    }
+    EASY_ASSERT(carry == 0, "the product must fit");
+
+    EASY_FREE(scratch);
+    for (size_t i = 0; i < NTT_NUM_PRIMES; ++i) {
+        EASY_FREE(residues[i]);
+    }
+}
+
+/// @brief  Multiply two integers into a new buffer (the inputs may be views).
+static struct EasyInteger
+multiply_integers(struct EasyInteger const *const a,
+                  struct EasyInteger const *const b)
+{
+    if (a->sign == ZERO || b->sign == ZERO) {
+        return new_integer(ZERO, 0);
+    }
+
+    /* We make the first operand the longer one */
+    struct EasyInteger const *const x = a->length >= b->length ? a : b;
+    struct EasyInteger const *const y = a->length >= b->length ? b : a;
+    enum EasyIntegerSign const sign = a->sign == b->sign ? POSITIVE : NEGATIVE;
+    struct EasyInteger me = new_integer(sign, x->length + y->length);
+    if (y->length < MAX(EasyInteger__karatsuba_threshold, MIN_SPLIT_LENGTH)) {
+        multiply_basecase(&me, x, y);
+    } else if (y->length >= EasyInteger__ntt_threshold &&
+               is_ntt_feasible(x->length, y->length)) {
+        multiply_ntt(&me, x, y);
+    } else if (y->length <= (x->length + 1) / 2) {
+        multiply_unbalanced(&me, x, y);
+    } else if (y->length >= EasyInteger__toom3_threshold &&
+               y->length > 2 * ((x->length + 2) / 3)) {
+        multiply_toom3(&me, x, y);
+    } else {
+        multiply_karatsuba(&me, x, y);
+    }
+    normalize(&me);
+    return me;
+}
+
+/*******************************************************************************
+ *  DIVISION
+ ******************************************************************************/
+
+size_t EasyInteger__newton_division_threshold =
+    EASY_INTEGER_NEWTON_DIVISION_THRESHOLD;
+
+/// @brief  Shift limbs left by fewer than 64 bits, returning the bits that
+///         were shifted out of the top.
+static uint64_t
+shift_left_bits(uint64_t *const out,
+                uint64_t const *const in,
+                size_t const length,
+                unsigned const shift)
+{
+    if (shift == 0) {
+        memmove(out, in, length * sizeof(*out));
+        return 0;
+    }
+    uint64_t carry = 0;
+    for (size_t i = 0; i < length; ++i) {
+        uint64_t const limb = in[i];
+        out[i] = (limb << shift) | carry;
+        carry = limb >> (LIMB_BITS - shift);
+    }
+    return carry;
+}
+
+/// @brief  Divide magnitudes with Knuth's Algorithm D, which is O(n * m). The
+///         divisor must have at least two limbs.
+/// Source: Knuth, TAOCP Vol. 2, Section 4.3.1.D; Warren, "Hacker's Delight",
+///         Section 9.2
+static void
+divide_knuth(struct EasyInteger const *const a,
+             struct EasyInteger const *const b,
+             struct EasyInteger *const quotient,
+             struct EasyInteger *const remainder)
+{
+    size_t const m = a->length, n = b->length;
+    EASY_ASSERT(n >= 2 && m >= n, "invalid operands");
+    /* We scale both operands so that the divisor's top bit is set, which makes
+     * our estimate of each quotient limb at most two too large */
+    unsigned const shift = (unsigned)__builtin_clzll(b->data[n - 1]);
+    uint64_t *vn = EASY_MALLOC(n, sizeof(*vn));
+    uint64_t *un = EASY_MALLOC(m + 1, sizeof(*un));
+    shift_left_bits(vn, b->data, n, shift);
+    un[m] = shift_left_bits(un, a->data, m, shift);
+
+    struct EasyInteger q = new_integer(POSITIVE, m - n + 1);
+    for (size_t j = m - n + 1; j-- > 0;) {
+        EasyDoubleLimb const numerator =
+            ((EasyDoubleLimb)un[j + n] << LIMB_BITS) | un[j + n - 1];
+        EasyDoubleLimb qhat = numerator / vn[n - 1];
+        EasyDoubleLimb rhat = numerator % vn[n - 1];
+        while ((qhat >> LIMB_BITS) != 0 ||
+               qhat * vn[n - 2] > ((rhat << LIMB_BITS) | un[j + n - 2])) {
+            --qhat;
+            rhat += vn[n - 1];
+            if ((rhat >> LIMB_BITS) != 0) {
+                break;
+            }
+        }
+
+        /* Multiply and subtract */
+        EasySignedDoubleLimb borrow = 0, diff = 0;
+        for (size_t i = 0; i < n; ++i) {
+            EasyDoubleLimb const product = qhat * vn[i];
+            diff = (EasySignedDoubleLimb)un[i + j] - borrow -
+                   (EasySignedDoubleLimb)(uint64_t)product;
+            un[i + j] = (uint64_t)diff;
+            borrow = (EasySignedDoubleLimb)(product >> LIMB_BITS) -
+                     (diff >> LIMB_BITS);
+        }
+        diff = (EasySignedDoubleLimb)un[j + n] - borrow;
+        un[j + n] = (uint64_t)diff;
+
+        /* Our estimate was one too large, so we add the divisor back */
+        if (diff < 0) {
+            --qhat;
+            uint64_t carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                EasyDoubleLimb const sum =
+                    (EasyDoubleLimb)un[i + j] + vn[i] + carry;
+                un[i + j] = (uint64_t)sum;
+                carry = (uint64_t)(sum >> LIMB_BITS);
+            }
+            un[j + n] += carry;
+        }
+        q.data[j] = (uint64_t)qhat;
+    }
+
+    /* Unscale the remainder */
+    struct EasyInteger r = new_integer(POSITIVE, n);
+    for (size_t i = 0; i < n; ++i) {
+        r.data[i] = shift == 0 ? un[i]
+                               : (un[i] >> shift) |
+                                     (un[i + 1] << (LIMB_BITS - shift));
+    }
+    normalize(&q);
+    normalize(&r);
+    EASY_FREE(vn);
+    EASY_FREE(un);
+    *quotient = q;
+    *remainder = r;
+}
+
+/// @brief  Divide magnitudes in O(n * m), where the divisor is non-zero.
+static void
+divide_schoolbook(struct EasyInteger const *const a,
+                  struct EasyInteger const *const b,
+                  struct EasyInteger *const quotient,
+                  struct EasyInteger *const remainder)
+{
+    if (compare_magnitude(a, b) < 0) {
+        *quotient = new_integer(ZERO, 0);
+        *remainder = duplicate_integer(a);
+    } else if (b->length == 1) {
+        *quotient = duplicate_integer(a);
+        quotient->sign = POSITIVE;
+        uint64_t const r =
+            divide_limb(quotient->data, quotient->length, b->data[0]);
+        normalize(quotient);
+        *remainder = new_integer(POSITIVE, 1);
+        remainder->data[0] = r;
+        normalize(remainder);
+    } else {
+        divide_knuth(a, b, quotient, remainder);
+    }
+}
+
+/// @brief  Compute floor(B^(2n) / d) by Newton's iteration, where d has n
+///         limbs and B = 2^64. We seed the iteration with the reciprocal of the
+///         top half of d, so a couple of full-precision steps suffice and the
+///         total cost is a small multiple of M(n).
+/// Source: Brent and Zimmermann, "Modern Computer Arithmetic", Section 3.4
+static struct EasyInteger
+new_reciprocal(struct EasyInteger const *const d)
+{
+    size_t const n = d->length;
+    EASY_ASSERT(n > 0, "we cannot invert zero");
+    struct EasyInteger radix_power = new_integer(POSITIVE, 2 * n + 1);
+    radix_power.data[2 * n] = 1;
+    if (n < MAX(EasyInteger__newton_division_threshold, (size_t)2)) {
+        struct EasyInteger y = {0}, r = {0};
+        divide_schoolbook(&radix_power, d, &y, &r);
+        EasyInteger__destroy(&radix_power);
+        EasyInteger__destroy(&r);
+        return y;
+    }
+
+    /* B^(2n) / d ~ B^(2h) / top * B^(n-h), where top is the top h limbs */
+    size_t const h = (n + 1) / 2;
+    struct EasyInteger const top = new_view(d, n - h, h);
+    struct EasyInteger top_reciprocal = new_reciprocal(&top);
+    struct EasyInteger y =
+        new_integer(POSITIVE, top_reciprocal.length + n - h);
+    memcpy(&y.data[n - h],
+           top_reciprocal.data,
+           top_reciprocal.length * sizeof(*y.data));
+    EasyInteger__destroy(&top_reciprocal);
+
+    /* One step of y += y (B^(2n) - d y) / B^(2n) doubles the precision of the
+     * seed, which leaves y within a couple of limbs of full precision */
+    struct EasyInteger dy = multiply_integers(d, &y);
+    struct EasyInteger error = subtract_integers(&radix_power, &dy);
+    struct EasyInteger product = multiply_integers(&y, &error);
+    struct EasyInteger step = new_view(&product, 2 * n, product.length);
+    step.sign = step.sign == ZERO ? ZERO : product.sign;
+    struct EasyInteger next = add_integers(&y, &step);
+    EasyInteger__destroy(&y);
+    EasyInteger__destroy(&dy);
+    EasyInteger__destroy(&error);
+    EasyInteger__destroy(&product);
+    y = next;
+
+    /* Correct y by floor((B^(2n) - d y) / d). This quotient is only a couple
+     * of limbs long, so schoolbook division finds it in O(n). */
+    struct EasyInteger const one = {.sign = POSITIVE,
+                                    .data = (uint64_t[]){1},
+                                    .length = 1};
+    dy = multiply_integers(d, &y);
+    error = subtract_integers(&radix_power, &dy);
+    struct EasyInteger const magnitude = new_view(&error, 0, error.length);
+    struct EasyInteger correction = {0}, remainder = {0};
+    divide_schoolbook(&magnitude, d, &correction, &remainder);
+    if (error.sign == NEGATIVE && remainder.sign != ZERO) {
+        struct EasyInteger rounded = add_integers(&correction, &one);
+        EasyInteger__destroy(&correction);
+        correction = rounded;
+    }
+    next = error.sign == NEGATIVE ? subtract_integers(&y, &correction)
+                                  : add_integers(&y, &correction);
+    EasyInteger__destroy(&y);
+    EasyInteger__destroy(&dy);
+    EasyInteger__destroy(&error);
+    EasyInteger__destroy(&correction);
+    EasyInteger__destroy(&remainder);
+    y = next;
+
+    EasyInteger__destroy(&radix_power);
+    return y;
+}
+
+/// @brief  Divide a non-negative x < B^(2n) by d, where d has n limbs, using
+///         its reciprocal mu = floor(B^(2n) / d).
+/// Source: Barrett, "Implementing the Rivest Shamir and Adleman Public Key
+///         Encryption Algorithm on a Standard Digital Signal Processor" (1986)
+static void
+divide_barrett(struct EasyInteger const *const x,
+               struct EasyInteger const *const d,
+               struct EasyInteger const *const mu,
+               struct EasyInteger *const quotient,
+               struct EasyInteger *const remainder)
+{
+    size_t const n = d->length;
+    EASY_ASSERT(x->length <= 2 * n, "the dividend is too large");
+    struct EasyInteger const x_top = new_view(x, n - 1, x->length);
+    struct EasyInteger estimate = multiply_integers(&x_top, mu);
+    struct EasyInteger const q_view =
+        new_view(&estimate, n + 1, estimate.length);
+    struct EasyInteger q = duplicate_integer(&q_view);
+    struct EasyInteger qd = multiply_integers(&q, d);
+    struct EasyInteger r = subtract_integers(x, &qd);
+    EasyInteger__destroy(&estimate);
+    EasyInteger__destroy(&qd);
+
+    /* The estimate is at most two too small */
+    struct EasyInteger const one = {.sign = POSITIVE,
+                                    .data = (uint64_t[]){1},
+                                    .length = 1};
+    EASY_ASSERT(r.sign != NEGATIVE, "the estimate must not be too large");
+    while (compare_magnitude(&r, d) >= 0) {
+        struct EasyInteger next_r = subtract_integers(&r, d);
+        struct EasyInteger next_q = add_integers(&q, &one);
+        EasyInteger__destroy(&r);
+        EasyInteger__destroy(&q);
+        r = next_r;
+        q = next_q;
+    }
+    *quotient = q;
+    *remainder = r;
+}
+
+/// @brief  Divide magnitudes using the divisor's reciprocal, bringing down n
+///         limbs of the dividend at a time. This is O((m / n) M(n)).
+static void
+divide_newton(struct EasyInteger const *const a,
+              struct EasyInteger const *const b,
+              struct EasyInteger *const quotient,
+              struct EasyInteger *const remainder)
+{
+    size_t const n = b->length;
+    struct EasyInteger mu = new_reciprocal(b);
+    struct EasyInteger q = new_integer(POSITIVE, a->length);
+    struct EasyInteger r = new_integer(ZERO, 0);
+    for (size_t end = a->length; end > 0;) {
+        size_t const start = end > n ? end - n : 0;
+        /* The partial dividend r * B^(end - start) + a[start:end] is below
+         * B^(2n), since r < b */
+        struct EasyInteger partial =
+            new_integer(POSITIVE, end - start + r.length);
+        memcpy(partial.data,
+               &a->data[start],
+               (end - start) * sizeof(*a->data));
+        memcpy(&partial.data[end - start], r.data, r.length * sizeof(*r.data));
+        normalize(&partial);
+        struct EasyInteger q_block = {0};
+        EasyInteger__destroy(&r);
+        divide_barrett(&partial, b, &mu, &q_block, &r);
+        add_shifted(q.data, q.length, &q_block, start);
+        EasyInteger__destroy(&partial);
+        EasyInteger__destroy(&q_block);
+        end = start;
+    }
+    EasyInteger__destroy(&mu);
+    normalize(&q);
+    *quotient = q;
+    *remainder = r;
+}
+
+/// @brief  Divide the magnitude of a by the (non-zero) magnitude of b.
+static void
+divide_magnitude(struct EasyInteger const *const a,
+                 struct EasyInteger const *const b,
+                 struct EasyInteger *const quotient,
+                 struct EasyInteger *const remainder)
+{
+    size_t const threshold =
+        MAX(EasyInteger__newton_division_threshold, (size_t)2);
+    struct EasyInteger const a_ = new_view(a, 0, a->length);
+    struct EasyInteger const b_ = new_view(b, 0, b->length);
+    EASY_GUARD(b_.sign != ZERO, "division by zero");
+    if (b_.length >= threshold && a_.length >= b_.length + threshold) {
+        divide_newton(&a_, &b_, quotient, remainder);
+    } else {
+        divide_schoolbook(&a_, &b_, quotient, remainder);
+    }
+}
+
+/// @brief  Divide, rounding the quotient towards negative infinity, into new
+///         buffers (the inputs may be views). Either output may be NULL.
+static void
+divide_floor(struct EasyInteger const *const a,
+             struct EasyInteger const *const b,
+             struct EasyInteger *const quotient,
+             struct EasyInteger *const remainder)
+{
+    struct EasyInteger q = {0}, r = {0};
+    divide_magnitude(a, b, &q, &r);
+    if (q.sign != ZERO) {
+        q.sign = a->sign * b->sign;
+    }
+    if (r.sign != ZERO) {
+        r.sign = a->sign;
+    }
+    /* We round the quotient towards negative infinity, so a non-zero remainder
+     * takes the sign of the divisor */
+    if (r.sign != ZERO && a->sign != b->sign) {
+        struct EasyInteger const one = {.sign = POSITIVE,
+                                        .data = (uint64_t[]){1},
+                                        .length = 1};
+        struct EasyInteger next_q = subtract_integers(&q, &one);
+        struct EasyInteger next_r = add_integers(&r, b);
+        EasyInteger__destroy(&q);
+        EasyInteger__destroy(&r);
+        q = next_q;
+        r = next_r;
+    }
+    if (quotient != NULL) {
+        *quotient = q;
+    } else {
+        EasyInteger__destroy(&q);
+    }
+    if (remainder != NULL) {
+        *remainder = r;
+    } else {
+        EasyInteger__destroy(&r);
+    }
+}
+
+/// @brief  Get the number of bits in the magnitude.
+static size_t
+bit_length(struct EasyInteger const *const me)
+{
+    if (me->length == 0) {
+        return 0;
+    }
+    return me->length * LIMB_BITS -
+           (size_t)__builtin_clzll(me->data[me->length - 1]);
+}
+
+/// @brief  Get the i-th bit of the magnitude.
+static unsigned
+get_bit(struct EasyInteger const *const me, size_t const i)
+{
+    return (unsigned)(me->data[i / LIMB_BITS] >> (i % LIMB_BITS)) & 1;
+}
+
+/* A modulus for repeated reductions. Once it is long enough for Newton
+ * division to pay off, we compute its reciprocal once and reuse it. */
+struct EasyModulus {
+    struct EasyInteger const *modulus;
+    bool has_reciprocal;
+    struct EasyInteger reciprocal;
+};
+
+static struct EasyModulus
+new_modulus(struct EasyInteger const *const modulus)
+{
+    struct EasyModulus m = {.modulus = modulus};
+    if (modulus->length >= EasyInteger__newton_division_threshold) {
+        m.has_reciprocal = true;
+        m.reciprocal = new_reciprocal(modulus);
+    }
+    return m;
+}
+
+/// @brief  Multiply two residues modulo m.
+static struct EasyInteger
+multiply_modulo(struct EasyModulus const *const m,
+                struct EasyInteger const *const a,
+                struct EasyInteger const *const b)
+{
+    struct EasyInteger product = multiply_integers(a, b);
+    struct EasyInteger q = {0}, r = {0};
+    if (m->has_reciprocal) {
+        divide_barrett(&product, m->modulus, &m->reciprocal, &q, &r);
+    } else {
+        divide_magnitude(&product, m->modulus, &q, &r);
+    }
+    EasyInteger__destroy(&product);
+    EasyInteger__destroy(&q);
+    return r;
+}
+
+static void
+destroy_modulus(struct EasyModulus *const m)
+{
+    if (m->has_reciprocal) {
+        EasyInteger__destroy(&m->reciprocal);
+    }
+    *m = (struct EasyModulus){0};
+}
+
+/// @brief  Compute (base ** exponent) mod modulus into a new buffer (the inputs
+///         may be views).
+static struct EasyInteger
+modpow_integers(struct EasyInteger const *const base,
+                struct EasyInteger const *const exponent,
+                struct EasyInteger const *const modulus)
+{
+    struct EasyModulus m = new_modulus(modulus);
+    struct EasyInteger reduced_base = {0};
+    divide_floor(base, modulus, NULL, &reduced_base);
+
+    /* Sliding windows: we precompute the odd powers base^1, base^3, ...,
+     * base^(2^w - 1) and then consume up to w bits of the exponent per
+     * multiplication. Larger windows pay off for longer exponents.
+     * Source: Menezes et al., "Handbook of Applied Cryptography", Algorithm
+     *         14.85 */
+    size_t const bits = bit_length(exponent);
+    unsigned const window = bits <= 8     ? 1
+                            : bits <= 24  ? 2
+                            : bits <= 80  ? 3
+                            : bits <= 240 ? 4
+                            : bits <= 672 ? 5
+                                          : 6;
+    struct EasyInteger odd_powers[1 << 5] = {{0}};
+    size_t const num_odd_powers = (size_t)1 << (window - 1);
+    odd_powers[0] = reduced_base;
+    if (num_odd_powers > 1) {
+        struct EasyInteger square =
+            multiply_modulo(&m, &reduced_base, &reduced_base);
+        for (size_t i = 1; i < num_odd_powers; ++i) {
+            odd_powers[i] = multiply_modulo(&m, &odd_powers[i - 1], &square);
+        }
+        EasyInteger__destroy(&square);
+    }
+
+    /* The result is one until we see the exponent's first set bit */
+    struct EasyInteger result = new_integer(ZERO, 0);
+    bool is_one = true;
+    for (size_t i = bits; i > 0;) {
+        if (!get_bit(exponent, i - 1)) {
+            struct EasyInteger square = multiply_modulo(&m, &result, &result);
+            EasyInteger__destroy(&result);
+            result = square;
+            --i;
+            continue;
+        }
+        /* Take the longest window of at most w bits that ends in a one */
+        size_t low = i > window ? i - window : 0;
+        while (!get_bit(exponent, low)) {
+            ++low;
+        }
+        size_t value = 0;
+        for (size_t j = i; j > low; --j) {
+            value = (value << 1) | get_bit(exponent, j - 1);
+            if (!is_one) {
+                struct EasyInteger square =
+                    multiply_modulo(&m, &result, &result);
+                EasyInteger__destroy(&result);
+                result = square;
+            }
+        }
+        if (is_one) {
+            EasyInteger__destroy(&result);
+            result = duplicate_integer(&odd_powers[value / 2]);
+            is_one = false;
+        } else {
+            struct EasyInteger product =
+                multiply_modulo(&m, &result, &odd_powers[value / 2]);
+            EasyInteger__destroy(&result);
+            result = product;
+        }
+        i = low;
+    }
+    if (is_one) {
+        /* Every integer to the power of zero is one (modulo the modulus) */
+        struct EasyInteger const one = {.sign = POSITIVE,
+                                        .data = (uint64_t[]){1},
+                                        .length = 1};
+        EasyInteger__destroy(&result);
+        divide_floor(&one, modulus, NULL, &result);
+    }
+    for (size_t i = 0; i < num_odd_powers; ++i) {
+        EasyInteger__destroy(&odd_powers[i]);
+    }
+    destroy_modulus(&m);
+    return result;
+}
+
+/*******************************************************************************
+ *  RADIX CONVERSION
+ ******************************************************************************/
+
+/* We convert between decimal and binary by divide and conquer: we split the
+ * number at a power 10^(19 * 2^k) and convert each half recursively. This makes
+ * conversion O(M(n) log n) rather than O(n^2), where M(n) is the cost of
+ * multiplying n-limb numbers. Below this many limbs, we convert directly.
+ * Source: Brent and Zimmermann, "Modern Computer Arithmetic", Section 1.7 */
+#define DECIMAL_SPLIT_LIMBS 32
+#define MAX_DECIMAL_LEVELS  64
+
+/* We cache the powers 10^(19 * 2^k) and their reciprocals between calls, since
+ * the same numbers are converted again and again. These are never freed, so
+ * they must not allocate from the current arena, which may die before them.
+ *
+ * Any thread may extend the caches, so we fill them under a lock and publish
+ * the new lengths with release stores. A thread that sees a length with an
+ * acquire load may then read those entries without the lock. */
+static struct EasyInteger decimal_powers[MAX_DECIMAL_LEVELS];
+static struct EasyInteger decimal_reciprocals[MAX_DECIMAL_LEVELS];
+static size_t num_decimal_powers = 0;
+static size_t num_decimal_reciprocals = 0;
+static pthread_mutex_t decimal_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/// @brief  Get the number of digits in the power at a level, 19 * 2^k.
+static size_t
+get_decimal_power_digits(size_t const level)
+{
+    return (size_t)DECIMAL_CHUNK_DIGITS << level;
+}
+
+/// @brief  Compute the powers up to a level. We must hold the lock.
+static void
+fill_decimal_powers(size_t const level)
+{
+    size_t num_powers = num_decimal_powers;
+    while (num_powers <= level) {
+        if (num_powers == 0) {
+            decimal_powers[0] = new_integer(POSITIVE, 1);
+            decimal_powers[0].data[0] = DECIMAL_CHUNK_BASE;
+        } else {
+            struct EasyInteger const *const prev =
+                &decimal_powers[num_powers - 1];
+            decimal_powers[num_powers] = multiply_integers(prev, prev);
+        }
+        ++num_powers;
+        __atomic_store_n(&num_decimal_powers, num_powers, __ATOMIC_RELEASE);
+    }
+}
+
+/// @brief  Get the (borrowed) power 10^(19 * 2^k).
+static struct EasyInteger const *
+get_decimal_power(size_t const level)
+{
+    EASY_GUARD(level < MAX_DECIMAL_LEVELS, "level out of range");
+    if (__atomic_load_n(&num_decimal_powers, __ATOMIC_ACQUIRE) <= level) {
+        EASY_ASSERT(pthread_mutex_lock(&decimal_lock) == 0, "cannot lock");
+        struct EasyArena *const previous = EasyArena__enter(NULL);
+        fill_decimal_powers(level);
+        EasyArena__exit(previous);
+        EASY_ASSERT(pthread_mutex_unlock(&decimal_lock) == 0, "cannot unlock");
+    }
+    return &decimal_powers[level];
+}
+
+/// @brief  Get the (borrowed) reciprocal of the power at a level.
+static struct EasyInteger const *
+get_decimal_reciprocal(size_t const level)
+{
+    EASY_GUARD(level < MAX_DECIMAL_LEVELS, "level out of range");
+    if (__atomic_load_n(&num_decimal_reciprocals, __ATOMIC_ACQUIRE) <= level) {
+        EASY_ASSERT(pthread_mutex_lock(&decimal_lock) == 0, "cannot lock");
+        struct EasyArena *const previous = EasyArena__enter(NULL);
+        fill_decimal_powers(level);
+        size_t num_reciprocals = num_decimal_reciprocals;
+        while (num_reciprocals <= level) {
+            decimal_reciprocals[num_reciprocals] =
+                new_reciprocal(&decimal_powers[num_reciprocals]);
+            ++num_reciprocals;
+            __atomic_store_n(&num_decimal_reciprocals,
+                             num_reciprocals,
+                             __ATOMIC_RELEASE);
+        }
+        EasyArena__exit(previous);
+        EASY_ASSERT(pthread_mutex_unlock(&decimal_lock) == 0, "cannot unlock");
+    }
+    return &decimal_reciprocals[level];
+}
+
+/// @brief  Parse decimal digits (without a sign) into a magnitude.
+static struct EasyInteger
+parse_decimal(char const *const digits, size_t const num_digits)
+{
+    if (num_digits > DECIMAL_SPLIT_LIMBS * DECIMAL_CHUNK_DIGITS) {
+        /* Split off the largest power of ten that leaves some high digits */
+        size_t level = 0;
+        while (get_decimal_power_digits(level + 1) < num_digits) {
+            ++level;
+        }
+        size_t const low_digits = get_decimal_power_digits(level);
+        size_t const high_digits = num_digits - low_digits;
+        struct EasyInteger high = parse_decimal(digits, high_digits);
+        struct EasyInteger low =
+            parse_decimal(&digits[high_digits], low_digits);
+        struct EasyInteger shifted =
+            multiply_integers(&high, get_decimal_power(level));
+        struct EasyInteger me = add_integers(&shifted, &low);
+        EasyInteger__destroy(&high);
+        EasyInteger__destroy(&low);
+        EasyInteger__destroy(&shifted);
+        return me;
+    }
+
+    /* Each limb holds at least DECIMAL_CHUNK_DIGITS digits */
+    struct EasyInteger me = new_integer(
+        POSITIVE,
+        (num_digits + DECIMAL_CHUNK_DIGITS - 1) / DECIMAL_CHUNK_DIGITS);
+    size_t length = 0;
+    /* The first chunk takes the leftover digits so the rest are all full */
+    size_t chunk_digits = num_digits % DECIMAL_CHUNK_DIGITS;
+    if (chunk_digits == 0) {
+        chunk_digits = DECIMAL_CHUNK_DIGITS;
+    }
+    for (size_t i = 0; i < num_digits;) {
+        uint64_t chunk = 0, scale = 1;
+        for (size_t j = 0; j < chunk_digits; ++j, ++i) {
+            chunk = 10 * chunk + (uint64_t)(digits[i] - '0');
+            scale *= 10;
+        }
+        uint64_t const carry =
+            multiply_add_limb(me.data, length, scale, chunk);
+        if (carry != 0) {
+            me.data[length++] = carry;
+        }
+        chunk_digits = DECIMAL_CHUNK_DIGITS;
+    }
+    me.length = length;
+    normalize(&me);
+    return me;
+}
+
+/// @brief  Write exactly 2 * 19 * 2^k digits of a magnitude x < 10^(that many)
+///         into the buffer, padding with leading zeros.
+static void
+write_decimal(struct EasyInteger const *const x,
+              size_t const level,
+              char *const buffer)
+{
+    size_t const num_digits = 2 * get_decimal_power_digits(level);
+    if (level > 0 && x->length > DECIMAL_SPLIT_LIMBS) {
+        struct EasyInteger high = {0}, low = {0};
+        divide_barrett(x,
+                       get_decimal_power(level),
+                       get_decimal_reciprocal(level),
+                       &high,
+                       &low);
+        write_decimal(&high, level - 1, buffer);
+        write_decimal(&low, level - 1, &buffer[num_digits / 2]);
+        EasyInteger__destroy(&high);
+        EasyInteger__destroy(&low);
+        return;
+    }
+
+    /* Peel off decimal chunks from a scratch copy, least significant first */
+    uint64_t *scratch =
+        EASY_MALLOC(MAX(x->length, (size_t)1), sizeof(*scratch));
+    memcpy(scratch, x->data, x->length * sizeof(*scratch));
+    size_t length = x->length;
+    for (size_t end = num_digits; end > 0; end -= DECIMAL_CHUNK_DIGITS) {
+        uint64_t chunk = divide_limb(scratch, length, DECIMAL_CHUNK_BASE);
+        while (length > 0 && scratch[length - 1] == 0) {
+            --length;
+        }
+        for (size_t i = end; i > end - DECIMAL_CHUNK_DIGITS; --i) {
+            buffer[i - 1] = (char)('0' + chunk % 10);
+            chunk /= 10;
+        }
+    }
+    EASY_ASSERT(length == 0, "the number must fit in the digits");
+    EASY_FREE(scratch);
+}
+
+/// @brief  Convert an integer to a NIL-terminated decimal string, which the
+///         caller must free.
+static char *
+new_decimal_cstr(struct EasyInteger const *const me, size_t *const length)
+{
+    if (me->sign == ZERO) {
+        char *str = EASY_MALLOC(2, sizeof(*str));
+        str[0] = '0';
+        str[1] = '\0';
+        *length = 1;
+        return str;
+    }
+
+    /* Find the smallest level whose split covers the number */
+    struct EasyInteger const magnitude = new_view(me, 0, me->length);
+    size_t level = 0;
+    while (compare_magnitude(&magnitude, get_decimal_power(level + 1)) >= 0) {
+        ++level;
+    }
+    size_t const num_digits = 2 * get_decimal_power_digits(level);
+    char *str = EASY_MALLOC(num_digits + 2, sizeof(*str));
+    write_decimal(&magnitude, level, &str[1]);
+
+    /* Strip the leading zeros and add the sign */
+    size_t start = 1;
+    while (str[start] == '0') {
+        ++start;
+    }
+    if (me->sign == NEGATIVE) {
+        str[--start] = '-';
+    }
+    *length = num_digits + 1 - start;
+    memmove(str, &str[start], *length);
+    str[*length] = '\0';
+    return str;
+}
+
+/*******************************************************************************
+ *  INTEGER
+ ******************************************************************************/
+
 /** Convert a C-style string to an EasyInteger. */
 struct EasyInteger
 EasyInteger__from_cstr(char const *const str)
 {
-    struct EasyInteger me = {0};
-    char const *digit_str = NULL;
-    size_t num_char = strlen(str);
-    size_t num_digits = 0;
+    EASY_GUARD(str != NULL, "inputs must be non-null");
+    enum EasyIntegerSign sign = POSITIVE;
+    char const *digit_str = str;
 
     switch (str[0]) {
     case '0':
-        EASY_ASSERT(num_char == 1,
+        EASY_ASSERT(str[1] == '\0',
                     "the only valid string beginning with a '0' is \"0\"");
-        me.sign = ZERO;
-        me.data = EASY_CALLOC(1, sizeof(char));
-        me.data[0] = 0;
-        me.length = 1;
-        return me;
+        return new_small(0);
     case '-':
-        me.sign = NEGATIVE;
-        me.data = EASY_CALLOC(num_char - 1, sizeof(char));
-        me.length = num_char - 1;
-        digit_str = &str[1];
-        num_digits = num_char - 1;
+        sign = NEGATIVE;
+        ++digit_str;
         break;
     case '+':
-        me.sign = POSITIVE;
-        me.data = EASY_CALLOC(num_char - 1, sizeof(char));
-        me.length = num_char - 1;
-        digit_str = &str[1];
-        num_digits = num_char - 1;
+        ++digit_str;
         break;
     default:
         EASY_GUARD(isdigit(str[0]), "the string must begin with \"[+-0-9]\"");
-        me.sign = POSITIVE;
-        me.data = EASY_CALLOC(num_char, sizeof(char));
-        me.length = num_char;
-        digit_str = &str[0];
-        num_digits = num_char;
         break;
     }
 
+    size_t const num_digits = strlen(digit_str);
+    EASY_GUARD(num_digits > 0, "the string must contain digits");
     for (size_t i = 0; i < num_digits; ++i) {
-        /* Flip digits */
         EASY_GUARD(isdigit(digit_str[i]),
                    "the string must begin with \"[0-9]\"");
-        me.data[num_digits - 1 - i] = digit_str[i] - '0';
     }
-    return me;
+    /* Any 18 digits fit in an int64_t */
+    if (num_digits < DECIMAL_CHUNK_DIGITS) {
+        int64_t value = 0;
+        for (size_t i = 0; i < num_digits; ++i) {
+            value = 10 * value + (digit_str[i] - '0');
+        }
+        return new_small(sign == NEGATIVE ? -value : value);
+    }
+    struct EasyInteger me = parse_decimal(digit_str, num_digits);
+    if (me.sign != ZERO) {
+        me.sign = sign;
+    }
+    return canonicalize(me);
 }
 
 struct EasyInteger
 EasyInteger__copy(struct EasyInteger const *const me)
 {
     EASY_GUARD(me != NULL, "inputs must be non-null");
-    struct EasyInteger copy = *me;
-    /* Deep copy data so that the owner is clear */
-    copy.data = EASY_DUPLICATE(me->data, copy.length, sizeof(*copy.data));
+    struct EasyInteger copy = {
+        .sign = me->sign,
+        .data = me->data,
+        .length = me->length,
+        .small = me->small,
+        .hash = __atomic_load_n(&me->hash, __ATOMIC_RELAXED)};
+    /* The limbs are immutable, so we share the buffer */
+    if (me->data != NULL) {
+        copy.data = EASY_SHARED_RETAIN(me->data);
+    }
     return copy;
 }
 
-#define NUM_INTEGER_DIGITS 10
-
-/** Helper function to find the larger absolute value */
-static int
-compare_absolute_integer(struct EasyInteger const *const a,
-                         struct EasyInteger const *const b)
+struct EasyInteger
+EasyInteger__add(struct EasyInteger const *const a,
+                 struct EasyInteger const *const b)
 {
-    EASY_GUARD(a != NULL && a->data != NULL, "inputs must be non-null");
-    EASY_GUARD(b != NULL && b->data != NULL, "inputs must be non-null");
-    if (a->length > b->length) {
-        return 1;
-    } else if (b->length > a->length) {
-        return -1;
+    EASY_GUARD(a != NULL && b != NULL, "inputs must be non-null");
+    int64_t sum = 0;
+    if (a->data == NULL && b->data == NULL &&
+        !__builtin_add_overflow(a->small, b->small, &sum)) {
+        return new_small(sum);
     }
-
-    /* Starting from the most significant digit, work backwards until you find a
-     * difference */
-    for (size_t i = 0; i < a->length; ++i) {
-        uint8_t a_ = a->data[EASY_REVERSE_INDEX(a->length, i)];
-        uint8_t b_ = b->data[EASY_REVERSE_INDEX(b->length, i)];
-
-        if (a_ > b_) {
-            return 1;
-        } else if (b_ > a_) {
-            return -1;
-        }
+    if (a->sign == ZERO) {
+        return EasyInteger__copy(b);
+    } else if (b->sign == ZERO) {
+        return EasyInteger__copy(a);
     }
-
-    /* Return NULL if they are equal */
-    return 0;
+    uint64_t a_limb = 0, b_limb = 0;
+    struct EasyInteger const a_ = new_limb_view(a, &a_limb);
+    struct EasyInteger const b_ = new_limb_view(b, &b_limb);
+    return canonicalize(add_integers(&a_, &b_));
 }
 
 struct EasyInteger
-EasyInteger__add(struct EasyInteger const *const a,
+EasyInteger__sub(struct EasyInteger const *const a,
                  struct EasyInteger const *const b)
 {
-    EASY_GUARD(a != NULL && a->data != NULL, "inputs must be non-null");
-    EASY_GUARD(b != NULL && b->data != NULL, "inputs must be non-null");
-    struct EasyInteger me = {0};
-    if (a->sign == ZERO && b->sign == ZERO) {
-        /* This case could be subsumed by the next two cases */
-        return EasyInteger__from_cstr("0");
-    } else if (a->sign == ZERO) {
-        return EasyInteger__copy(b);
-    } else if (b->sign == ZERO) {
+    EASY_GUARD(a != NULL && b != NULL, "inputs must be non-null");
+    int64_t difference = 0;
+    if (a->data == NULL && b->data == NULL &&
+        !__builtin_sub_overflow(a->small, b->small, &difference)) {
+        return new_small(difference);
+    }
+    if (b->sign == ZERO) {
         return EasyInteger__copy(a);
-    } else if (a->sign == b->sign) {
-        size_t max_ans_length = MAX(a->length, b->length) + 1;
-
-        me.sign = a->sign; /* Sign matches both a and b */
-        me.data = EASY_CALLOC(max_ans_length, sizeof(*me.data));
-        me.length = 0; /* This will be iteratively lengthened */
-        signed char carry = 0;
-        /* Importantly, max_ans_length > MAX(a->length, b->length)! */
-        for (size_t i = 0; i < max_ans_length; ++i) {
-            signed char a_ = i < a->length ? a->data[i] : 0;
-            signed char b_ = i < b->length ? b->data[i] : 0;
-
-            if (a_ + b_ + carry >= NUM_INTEGER_DIGITS) {
-                me.data[i] = a_ + b_ + carry - NUM_INTEGER_DIGITS;
-                carry = 1;
-            } else {
-                me.data[i] = a_ + b_ + carry;
-                carry = 0;
-            }
-
-            if (me.data[i] > 0) {
-                me.length = i + 1;
-            }
-        }
-        return me;
-    } else {
-        size_t max_ans_length = MAX(a->length, b->length);
-        me.data = EASY_CALLOC(max_ans_length, sizeof(*me.data));
-        me.length = 0; /* This will be iteratively lengthened */
-
-        struct EasyInteger const *larger_int = NULL;
-        struct EasyInteger const *smaller_int = NULL;
-        switch (compare_absolute_integer(a, b)) {
-        case 0:
-            return EasyInteger__from_cstr("0");
-        case -1:
-            larger_int = b;
-            smaller_int = a;
-            break;
-        case +1:
-            larger_int = a;
-            smaller_int = b;
-            break;
-        default:
-            EASY_IMPOSSIBLE();
-        }
-        me.sign = larger_int->sign;
-
-        signed char borrow = 0;
-        /* Importantly, max_ans_length == MAX(a->length, b->length)! */
-        for (size_t i = 0; i < max_ans_length; ++i) {
-            signed char big_ = i < larger_int->length ? larger_int->data[i] : 0;
-            signed char small_ =
-                i < smaller_int->length ? smaller_int->data[i] : 0;
-
-            if (big_ - small_ - borrow < 0) {
-                me.data[i] = big_ - small_ - borrow + NUM_INTEGER_DIGITS;
-                borrow = 1;
-            } else {
-                me.data[i] = big_ - small_ - borrow;
-                borrow = 0;
-            }
-
-            if (me.data[i] > 0) {
-                me.length = i + 1;
-            }
-            EASY_ASSERT(0 <= me.data[i] && me.data[i] < NUM_INTEGER_DIGITS,
-                        "digits must be in range!");
-        }
-        return me;
     }
+    uint64_t a_limb = 0, b_limb = 0;
+    struct EasyInteger const a_ = new_limb_view(a, &a_limb);
+    struct EasyInteger const b_ = new_limb_view(b, &b_limb);
+    return canonicalize(subtract_integers(&a_, &b_));
 }
 
 struct EasyInteger
 EasyInteger__multiply(struct EasyInteger const *const a,
                       struct EasyInteger const *const b)
 {
-    EASY_GUARD(a != NULL && a->data != NULL, "inputs must be non-null");
-    EASY_GUARD(b != NULL && b->data != NULL, "inputs must be non-null");
-
-    struct EasyInteger me = {0};
+    EASY_GUARD(a != NULL && b != NULL, "inputs must be non-null");
+    int64_t product = 0;
+    if (a->data == NULL && b->data == NULL &&
+        !__builtin_mul_overflow(a->small, b->small, &product)) {
+        return new_small(product);
+    }
+    uint64_t a_limb = 0, b_limb = 0;
+    struct EasyInteger const a_ = new_limb_view(a, &a_limb);
+    struct EasyInteger const b_ = new_limb_view(b, &b_limb);
+    return canonicalize(multiply_integers(&a_, &b_));
+}
 
-    if (a->sign == ZERO || b->sign == ZERO) {
-        return EasyInteger__from_cstr("0");
-    } else if (a->sign == b->sign) {
-        me.sign = POSITIVE;
+void
+EasyInteger__divmod(struct EasyInteger const *const a,
+                    struct EasyInteger const *const b,
+                    struct EasyInteger *const quotient,
+                    struct EasyInteger *const remainder)
+{
+    EASY_GUARD(a != NULL && b != NULL, "inputs must be non-null");
+    EASY_GUARD(b->sign != ZERO, "division by zero");
+    /* Only INT64_MIN / -1 overflows */
+    if (a->data == NULL && b->data == NULL &&
+        !(a->small == INT64_MIN && b->small == -1)) {
+        int64_t q = a->small / b->small, r = a->small % b->small;
+        /* C rounds towards zero, but we round towards negative infinity */
+        if (r != 0 && (r < 0) != (b->small < 0)) {
+            --q;
+            r += b->small;
+        }
+        if (quotient != NULL) {
+            *quotient = new_small(q);
+        }
+        if (remainder != NULL) {
+            *remainder = new_small(r);
+        }
+        return;
+    }
+    uint64_t a_limb = 0, b_limb = 0;
+    struct EasyInteger const a_ = new_limb_view(a, &a_limb);
+    struct EasyInteger const b_ = new_limb_view(b, &b_limb);
+    struct EasyInteger q = {0}, r = {0};
+    divide_floor(&a_, &b_, &q, &r);
+    if (quotient != NULL) {
+        *quotient = canonicalize(q);
     } else {
-        me.sign = NEGATIVE;
+        EasyInteger__destroy(&q);
     }
+    if (remainder != NULL) {
+        *remainder = canonicalize(r);
+    } else {
+        EasyInteger__destroy(&r);
+    }
+}
 
-    const size_t max_ans_length = a->length + b->length;
-    /* Relies on the fact that it zeroes the array */
-    me.data = EASY_CALLOC(max_ans_length, sizeof(*me.data));
-    EASY_SET_POINTER_ARRAY_ZERO(me.data, max_ans_length);
-    for (size_t i = 0; i < a->length; ++i) {
-        for (size_t j = 0; j < b->length; ++j) {
-            signed char product = a->data[i] * b->data[j] + me.data[i + j];
-            if (product >= NUM_INTEGER_DIGITS) {
-                me.data[i + j] = product % NUM_INTEGER_DIGITS;
-                me.data[i + j + 1] += product / NUM_INTEGER_DIGITS;
-            } else {
-                me.data[i + j] = product;
+struct EasyInteger
+EasyInteger__pow(struct EasyInteger const *const base,
+                 struct EasyInteger const *const exponent)
+{
+    EASY_GUARD(base != NULL && exponent != NULL, "inputs must be non-null");
+    EASY_GUARD(exponent->sign != NEGATIVE, "the exponent must be non-negative");
+    uint64_t base_limb = 0, exponent_limb = 0;
+    struct EasyInteger const base_ = new_limb_view(base, &base_limb);
+    struct EasyInteger const exponent_ =
+        new_limb_view(exponent, &exponent_limb);
+    struct EasyInteger result = new_integer(POSITIVE, 1);
+    result.data[0] = 1;
+    /* Left-to-right binary exponentiation */
+    for (size_t i = bit_length(&exponent_); i-- > 0;) {
+        struct EasyInteger square = multiply_integers(&result, &result);
+        EasyInteger__destroy(&result);
+        result = square;
+        if (get_bit(&exponent_, i)) {
+            struct EasyInteger product = multiply_integers(&result, &base_);
+            EasyInteger__destroy(&result);
+            result = product;
+        }
+    }
+    return canonicalize(result);
+}
+
+struct EasyInteger
+EasyInteger__modpow(struct EasyInteger const *const base,
+                    struct EasyInteger const *const exponent,
+                    struct EasyInteger const *const modulus)
+{
+    EASY_GUARD(base != NULL && exponent != NULL && modulus != NULL,
+               "inputs must be non-null");
+    EASY_GUARD(exponent->sign != NEGATIVE, "the exponent must be non-negative");
+    EASY_GUARD(modulus->sign == POSITIVE, "the modulus must be positive");
+    uint64_t base_limb = 0, exponent_limb = 0, modulus_limb = 0;
+    struct EasyInteger const base_ = new_limb_view(base, &base_limb);
+    struct EasyInteger const exponent_ =
+        new_limb_view(exponent, &exponent_limb);
+    struct EasyInteger const modulus_ = new_limb_view(modulus, &modulus_limb);
+    if (modulus->data == NULL) {
+        /* The residues fit in a limb, so we multiply them in 128 bits */
+        uint64_t const m = modulus_limb;
+        uint64_t reduced_base = 0;
+        for (size_t i = base_.length; i-- > 0;) {
+            reduced_base = (uint64_t)(
+                (((EasyDoubleLimb)reduced_base << LIMB_BITS) | base_.data[i]) %
+                m);
+        }
+        if (base_.sign == NEGATIVE && reduced_base != 0) {
+            reduced_base = m - reduced_base;
+        }
+        uint64_t result = 1 % m;
+        for (size_t i = bit_length(&exponent_); i-- > 0;) {
+            result = (uint64_t)((EasyDoubleLimb)result * result % m);
+            if (get_bit(&exponent_, i)) {
+                result = (uint64_t)((EasyDoubleLimb)result * reduced_base % m);
             }
         }
+        return new_small((int64_t)result);
     }
+    return canonicalize(modpow_integers(&base_, &exponent_, &modulus_));
+}
 
-    /* Set length */
-    for (size_t i = 0; i < max_ans_length; ++i) {
-        size_t idx = EASY_REVERSE_INDEX(max_ans_length, i);
-        signed char digit = me.data[idx];
-        if (digit != 0) {
-            EASY_ASSERT(0 <= digit && digit < NUM_INTEGER_DIGITS,
-                        "must be in range");
-            me.length = idx + 1;
-            break;
+struct EasyInteger
+EasyInteger__gcd(struct EasyInteger const *const a,
+                 struct EasyInteger const *const b)
+{
+    EASY_GUARD(a != NULL && b != NULL, "inputs must be non-null");
+    uint64_t a_limb = 0, b_limb = 0;
+    struct EasyInteger const a_ = new_limb_view(a, &a_limb);
+    struct EasyInteger const b_ = new_limb_view(b, &b_limb);
+    if (a->data == NULL && b->data == NULL) {
+        /* Euclid's algorithm on the magnitudes. The result only overflows an
+         * int64_t if it is 2^63 (e.g. the GCD of INT64_MIN and zero). */
+        uint64_t x = a_.length == 1 ? a_limb : 0;
+        uint64_t y = b_.length == 1 ? b_limb : 0;
+        while (y != 0) {
+            uint64_t const r = x % y;
+            x = y;
+            y = r;
         }
+        if (x <= INT64_MAX) {
+            return new_small((int64_t)x);
+        }
+    }
+    struct EasyInteger x = duplicate_integer(&a_), y = duplicate_integer(&b_);
+    x.sign = x.sign == ZERO ? ZERO : POSITIVE;
+    y.sign = y.sign == ZERO ? ZERO : POSITIVE;
+    /* Euclid's algorithm */
+    while (y.sign != ZERO) {
+        struct EasyInteger q = {0}, r = {0};
+        divide_magnitude(&x, &y, &q, &r);
+        EasyInteger__destroy(&q);
+        EasyInteger__destroy(&x);
+        x = y;
+        y = r;
     }
+    EasyInteger__destroy(&y);
+    return canonicalize(x);
+}
 
-    /* Assert no overflows */
-    for (size_t i = 0; i < max_ans_length; ++i) {
-        size_t idx = EASY_REVERSE_INDEX(max_ans_length, i);
-        signed char digit = me.data[idx];
-        EASY_ASSERT(0 <= digit && digit < NUM_INTEGER_DIGITS,
-                    "must be in range");
+int
+EasyInteger__compare(struct EasyInteger const *const a,
+                     struct EasyInteger const *const b)
+{
+    EASY_GUARD(a != NULL && b != NULL, "inputs must be non-null");
+    if (a->data == NULL && b->data == NULL) {
+        return (a->small > b->small) - (a->small < b->small);
+    }
+    if (a->sign != b->sign) {
+        return a->sign < b->sign ? -1 : 1;
     }
+    uint64_t a_limb = 0, b_limb = 0;
+    struct EasyInteger const a_ = new_limb_view(a, &a_limb);
+    struct EasyInteger const b_ = new_limb_view(b, &b_limb);
+    return a->sign * compare_magnitude(&a_, &b_);
+}
 
-    return me;
+size_t
+EasyInteger__to_cstr(struct EasyInteger const *const me,
+                     char *const buffer,
+                     size_t const size)
+{
+    EASY_GUARD(me != NULL, "input should be non-null");
+    EASY_GUARD(buffer != NULL || size == 0, "buffer must be non-null");
+    if (me->data == NULL) {
+        return (size_t)snprintf(buffer, size, "%" PRId64, me->small);
+    }
+    size_t length = 0;
+    char *str = new_decimal_cstr(me, &length);
+    if (size != 0) {
+        size_t const num_copied = MIN(length, size - 1);
+        memcpy(buffer, str, num_copied);
+        buffer[num_copied] = '\0';
+    }
+    EASY_FREE(str);
+    return length;
 }
 
 void
 EasyInteger__print(struct EasyInteger const *const me)
 {
-    EASY_GUARD(me != NULL && me->data != NULL, "input should be non-null");
-    if (me->sign == NEGATIVE) {
-        printf("-");
-    }
-    for (size_t i = 0; i < me->length; ++i) {
-        printf("%c", '0' + me->data[me->length - 1 - i]);
+    EASY_GUARD(me != NULL, "input should be non-null");
+    if (me->data == NULL) {
+        printf("%" PRId64, me->small);
+        return;
     }
+    size_t length = 0;
+    char *str = new_decimal_cstr(me, &length);
+    fwrite(str, sizeof(*str), length, stdout);
+    EASY_FREE(str);
 }
 
 void
 EasyInteger__print_json(struct EasyInteger const *const me)
 {
     EASY_GUARD(me != NULL, "pointer must not be NULL");
-    printf("{\"type\": \"EasyInteger\", \".sign\": %d, \".data\": ", me->sign);
-    /* NOTE This isn't guaranteed to be printed in such an easily readable
-     *      form! In future, I may just print the raw array. */
+    if (me->data == NULL) {
+        printf("{\"type\": \"EasyInteger\", \".sign\": %d, \".small\": %" PRId64
+               "}",
+               me->sign,
+               me->small);
+        return;
+    }
+    printf("{\"type\": \"EasyInteger\", \".sign\": %d, \".data\": [", me->sign);
+    /* NOTE We print the raw limbs, least significant first. */
     for (size_t i = 0; i < me->length; ++i) {
-        printf("%d", me->data[EASY_REVERSE_INDEX(me->length, i)]);
+        printf("%" PRIu64 "%s", me->data[i], i + 1 < me->length ? ", " : "");
     }
-    printf(", \".length\": %zu}", me->length);
+    printf("], \".length\": %zu}", me->length);
 }
 
 void
 EasyInteger__destroy(struct EasyInteger *const me)
 {
-    EASY_GUARD(me != NULL && me->data != NULL, "input should be non-null");
-    EASY_FREE(me->data);
+    EASY_GUARD(me != NULL, "input should be non-null");
+    if (me->data != NULL && EASY_SHARED_RELEASE(me->data)) {
+        EASY_SHARED_FREE(me->data);
+    }
 
     EASY_SET_ZERO(me);
 }
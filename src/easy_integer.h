@@ -7,12 +7,19 @@
  *
  *  Design Decisions
  *  ----------------
- *  1. Base-10. This is the most intuitive for most people; however, it makes
- *      bit shifts weird. It also makes terrible utilization of memory (only 10
- *      possible values per byte, which is just over 1 value per bit--so I would
- *      not be much worse off by one-hot encoding digits!). It also makes
- *      terrible natural utilization of the hardware.
- *      - In future, we may select a rather large power-of-two, such as 2^30.
+ *  1. Base-2^64. We store the magnitude as an array of 64-bit "limbs", least
+ *      significant first, and use 128-bit intermediates for the carries. This
+ *      packs ~19.3 decimal digits into each limb, so arithmetic does far fewer
+ *      iterations than it did with one decimal digit per byte. We only convert
+ *      to and from decimal when parsing and printing.
+ *  2. Sign-magnitude. The sign is stored separately from the magnitude.
+ *  3. Small values inline. Values that fit in an int64_t live directly in the
+ *      struct, with no buffer, so that creating, copying, hashing, and
+ *      comparing them never allocates. Arithmetic on two small values uses the
+ *      checked builtins and only falls back to limbs when it overflows.
+ *  4. Canonical form. Every value has exactly one representation: it is small
+ *      if and only if it fits in an int64_t, and otherwise the most
+ *      significant limb is never zero. Thus equal values hash equally.
  *
  ******************************************************************************/
 
@@ -21,15 +28,45 @@
 #define EASYINTEGER_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 enum EasyIntegerSign { NEGATIVE = -1, ZERO = 0, POSITIVE = +1 };
 
 struct EasyInteger {
     enum EasyIntegerSign sign;
-    signed char *data;
-    size_t length; /* Length of the data buffer -- no terminal NIL byte */
+    /* The limbs of the magnitude, least significant first. This is NULL if the
+     * value is small. */
+    uint64_t *data;
+    size_t length; /* The number of limbs in use (zero if the value is small) */
+    int64_t small; /* The value, if it is small */
+    uint64_t hash; /* The memoised hash (zero until we first compute it) */
 };
 
+/* Multiplication picks its algorithm by the length (in limbs) of the shorter
+ * operand: schoolbook below the Karatsuba threshold, Karatsuba up to the
+ * Toom-3 threshold, Toom-3 up to the NTT threshold, and three-prime number
+ * theoretic transforms above that. These are variables so that they
+ * may be tuned at runtime (see bench/); the defaults may be overridden at
+ * compile time. */
+#ifndef EASY_INTEGER_KARATSUBA_THRESHOLD
+#define EASY_INTEGER_KARATSUBA_THRESHOLD 64
+#endif
+#ifndef EASY_INTEGER_TOOM3_THRESHOLD
+#define EASY_INTEGER_TOOM3_THRESHOLD 256
+#endif
+#ifndef EASY_INTEGER_NTT_THRESHOLD
+#define EASY_INTEGER_NTT_THRESHOLD 4096
+#endif
+extern size_t EasyInteger__karatsuba_threshold;
+extern size_t EasyInteger__toom3_threshold;
+extern size_t EasyInteger__ntt_threshold;
+/* Division uses Knuth's Algorithm D until both the divisor and the quotient
+ * have at least this many limbs, and Newton's reciprocal above that. */
+#ifndef EASY_INTEGER_NEWTON_DIVISION_THRESHOLD
+#define EASY_INTEGER_NEWTON_DIVISION_THRESHOLD 2048
+#endif
+extern size_t EasyInteger__newton_division_threshold;
+
 struct EasyInteger
 EasyInteger__from_cstr(char const *const str);
 struct EasyInteger
@@ -40,6 +77,41 @@ EasyInteger__add(struct EasyInteger const *const a,
 struct EasyInteger
 EasyInteger__multiply(struct EasyInteger const *const a,
                       struct EasyInteger const *const b);
+struct EasyInteger
+EasyInteger__sub(struct EasyInteger const *const a,
+                 struct EasyInteger const *const b);
+/// @brief  Divide a by b, rounding the quotient towards negative infinity (so
+///         the remainder has the same sign as b). Either output may be NULL.
+void
+EasyInteger__divmod(struct EasyInteger const *const a,
+                    struct EasyInteger const *const b,
+                    struct EasyInteger *const quotient,
+                    struct EasyInteger *const remainder);
+/// @brief  Raise the base to a non-negative exponent.
+struct EasyInteger
+EasyInteger__pow(struct EasyInteger const *const base,
+                 struct EasyInteger const *const exponent);
+/// @brief  Compute (base ** exponent) mod modulus, which is in [0, modulus).
+///         The exponent must be non-negative and the modulus positive.
+struct EasyInteger
+EasyInteger__modpow(struct EasyInteger const *const base,
+                    struct EasyInteger const *const exponent,
+                    struct EasyInteger const *const modulus);
+/// @brief  Get the (non-negative) greatest common divisor.
+struct EasyInteger
+EasyInteger__gcd(struct EasyInteger const *const a,
+                 struct EasyInteger const *const b);
+/// @brief  Return -1, 0, or +1 if a is less than, equal to, or greater than b.
+int
+EasyInteger__compare(struct EasyInteger const *const a,
+                     struct EasyInteger const *const b);
+/// @brief  Write the decimal representation into the buffer, like snprintf.
+///         We write at most (size - 1) characters and a NIL terminator.
+/// @return The length of the full representation (excluding the NIL).
+size_t
+EasyInteger__to_cstr(struct EasyInteger const *const me,
+                     char *const buffer,
+                     size_t const size);
 void
 EasyInteger__print(struct EasyInteger const *const me);
 void
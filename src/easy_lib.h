@@ -21,13 +21,15 @@
  *  2. Simplicity over performance
  *  3. Data types are constant unless explicitly marked as "Mutable"
  *  4. Data is not shared unless explicity marked as "Shared"
+ *      - Since data types are constant, copies may share an underlying
+ *        buffer behind the scenes. This is invisible to the user.
  *  5. Simple error handling means printing a debug message and exiting
  *
  *  Common Functions
  *  ----------------
  *  Every object type must implement these functionality:
  *
- *  1. Recursively Copy
+ *  1. Recursively Copy (this may share immutable buffers)
  *  2. Recursively Destroy
  *  3. Recursively Pretty Print (c.f. Python's str(...) function)
  *      - In later versions, we will require implementing functions to convert
@@ -1,4 +1,5 @@
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -6,85 +7,687 @@
 #include "easy_lib.h"
 #include "easy_list.h"
 
+#define EASY_LIST_BITS_PER_LEVEL 5
+#define EASY_LIST_BRANCHING      (1 << EASY_LIST_BITS_PER_LEVEL)
+/* The number of extra nodes we tolerate over the optimum when concatenating
+ * before we redistribute their contents. */
+#define EASY_LIST_EXTRA_NODES 2
+
+union EasyListSlot {
+    struct EasyListNode *child;
+    struct EasyGenericObject element;
+};
+
+/* Nodes are immutable once they are reachable from a list. A node at shift 0
+ * is a leaf holding elements; a node at shift s > 0 holds children, each of
+ * which holds at most (1 << s) elements. */
+struct EasyListNode {
+    size_t refcount;
+    size_t length;   /* The number of slots in use */
+    size_t capacity; /* The number of slots allocated */
+    /* The cumulative number of elements up to and including each child. This
+     * is NULL for leaves and for "balanced" nodes, where every child except
+     * the last is full. */
+    size_t *sizes;
+    union EasyListSlot slots[];
+};
+
 static bool
 is_last_element(size_t i, size_t length)
 {
     return i == length - 1;
 }
 
+/*******************************************************************************
+ *  TRIE NODES
+ ******************************************************************************/
+
+static struct EasyListNode *
+new_node(size_t const capacity, bool const relaxed)
+{
+    EASY_GUARD(capacity <= EASY_LIST_BRANCHING, "capacity too large");
+    size_t const size = sizeof(struct EasyListNode) +
+                        capacity * sizeof(union EasyListSlot) +
+                        (relaxed ? capacity * sizeof(size_t) : 0);
+    struct EasyListNode *node = EASY_MALLOC(1, size);
+    node->refcount = 1;
+    node->length = 0;
+    node->capacity = capacity;
+    /* The sizes live in the same allocation, just after the slots */
+    node->sizes = relaxed ? (size_t *)&node->slots[capacity] : NULL;
+    return node;
+}
+
+static struct EasyListNode *
+retain_node(struct EasyListNode *const node)
+{
+    EASY_GUARD(node != NULL &&
+                   __atomic_load_n(&node->refcount, __ATOMIC_RELAXED) != 0,
+               "invalid node");
+    __atomic_add_fetch(&node->refcount, 1, __ATOMIC_RELAXED);
+    return node;
+}
+
+static void
+release_node(struct EasyListNode *const node, unsigned const shift)
+{
+    EASY_GUARD(node != NULL &&
+                   __atomic_load_n(&node->refcount, __ATOMIC_RELAXED) != 0,
+               "invalid node");
+    if (__atomic_sub_fetch(&node->refcount, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    for (size_t i = 0; i < node->length; ++i) {
+        if (shift == 0) {
+            EasyGenericObject__destroy(&node->slots[i].element);
+        } else {
+            release_node(node->slots[i].child,
+                         shift - EASY_LIST_BITS_PER_LEVEL);
+        }
+    }
+    EASY_FREE(node);
+}
+
+static size_t
+get_node_size(struct EasyListNode const *const node, unsigned const shift)
+{
+    if (shift == 0) {
+        return node->length;
+    } else if (node->sizes != NULL) {
+        return node->sizes[node->length - 1];
+    }
+    /* Every child but the last is full */
+    return ((node->length - 1) << shift) +
+           get_node_size(node->slots[node->length - 1].child,
+                         shift - EASY_LIST_BITS_PER_LEVEL);
+}
+
+/// @brief  Create a leaf by copying the elements in [start, end) of a leaf.
+static struct EasyListNode *
+new_leaf_from_slice(struct EasyListNode const *const leaf,
+                    size_t const start,
+                    size_t const end)
+{
+    EASY_GUARD(start < end && end <= leaf->length, "invalid slice");
+    struct EasyListNode *node = new_node(end - start, false);
+    for (size_t i = start; i < end; ++i) {
+        node->slots[node->length++].element =
+            EasyGenericObject__copy(&leaf->slots[i].element);
+    }
+    return node;
+}
+
+/// @brief  Create an internal node from the children, taking ownership of
+///         them. We only store the cumulative sizes if they are irregular.
+static struct EasyListNode *
+new_internal_node(struct EasyListNode *const *const children,
+                  size_t const count,
+                  unsigned const shift)
+{
+    EASY_GUARD(0 < count && count <= EASY_LIST_BRANCHING, "invalid count");
+    EASY_GUARD(shift > 0, "internal nodes must not be leaves");
+    size_t sizes[EASY_LIST_BRANCHING] = {0};
+    bool balanced = true;
+    for (size_t i = 0; i < count; ++i) {
+        size_t const size =
+            get_node_size(children[i], shift - EASY_LIST_BITS_PER_LEVEL);
+        if (!is_last_element(i, count) && size != (size_t)1 << shift) {
+            balanced = false;
+        }
+        sizes[i] = (i == 0 ? 0 : sizes[i - 1]) + size;
+    }
+
+    struct EasyListNode *node = new_node(count, !balanced);
+    for (size_t i = 0; i < count; ++i) {
+        node->slots[i].child = children[i];
+        if (node->sizes != NULL) {
+            node->sizes[i] = sizes[i];
+        }
+    }
+    node->length = count;
+    return node;
+}
+
+/// @brief  Find the child holding an index, updating the index to be relative
+///         to the start of the child.
+static size_t
+find_child(struct EasyListNode const *const node,
+           unsigned const shift,
+           size_t *const index)
+{
+    size_t idx = *index >> shift;
+    if (node->sizes == NULL) {
+        *index -= idx << shift;
+        return idx;
+    }
+    /* Children hold at most (1 << shift) elements, so we can only be behind */
+    while (node->sizes[idx] <= *index) {
+        ++idx;
+    }
+    *index -= idx == 0 ? 0 : node->sizes[idx - 1];
+    return idx;
+}
+
+static struct EasyGenericObject const *
+get_element(struct EasyListNode const *node, unsigned shift, size_t index)
+{
+    while (shift > 0) {
+        size_t const idx = find_child(node, shift, &index);
+        node = node->slots[idx].child;
+        shift -= EASY_LIST_BITS_PER_LEVEL;
+    }
+    EASY_ASSERT(index < node->length, "index out of range");
+    return &node->slots[index].element;
+}
+
+/// @brief  Wrap a leaf in single-child nodes until it reaches the shift.
+static struct EasyListNode *
+new_path(struct EasyListNode *const leaf, unsigned const shift)
+{
+    if (shift == 0) {
+        return leaf;
+    }
+    struct EasyListNode *child =
+        new_path(leaf, shift - EASY_LIST_BITS_PER_LEVEL);
+    return new_internal_node(&child, 1, shift);
+}
+
+/// @brief  Append a leaf to the rightmost edge of the subtrie, or return NULL
+///         if there is no room. We only take ownership of the leaf on success.
+static struct EasyListNode *
+push_leaf(struct EasyListNode const *const node,
+          unsigned const shift,
+          struct EasyListNode *const leaf)
+{
+    struct EasyListNode *children[EASY_LIST_BRANCHING] = {0};
+    size_t const last = node->length - 1;
+    struct EasyListNode *new_child = NULL;
+    if (shift > EASY_LIST_BITS_PER_LEVEL) {
+        new_child = push_leaf(node->slots[last].child,
+                              shift - EASY_LIST_BITS_PER_LEVEL,
+                              leaf);
+    }
+
+    if (new_child != NULL) {
+        for (size_t i = 0; i < last; ++i) {
+            children[i] = retain_node(node->slots[i].child);
+        }
+        children[last] = new_child;
+        return new_internal_node(children, node->length, shift);
+    } else if (node->length < EASY_LIST_BRANCHING) {
+        for (size_t i = 0; i < node->length; ++i) {
+            children[i] = retain_node(node->slots[i].child);
+        }
+        children[node->length] =
+            new_path(leaf, shift - EASY_LIST_BITS_PER_LEVEL);
+        return new_internal_node(children, node->length + 1, shift);
+    }
+    return NULL;
+}
+
+/// @brief  Append a leaf to a trie (which may be NULL), taking ownership of
+///         the leaf. We return the new root and update the shift.
+static struct EasyListNode *
+push_tail(struct EasyListNode *const root,
+          unsigned *const shift,
+          struct EasyListNode *const leaf)
+{
+    if (root == NULL) {
+        *shift = 0;
+        return leaf;
+    } else if (*shift > 0) {
+        struct EasyListNode *new_root = push_leaf(root, *shift, leaf);
+        if (new_root != NULL) {
+            return new_root;
+        }
+    }
+    /* The trie is full, so we grow a new level */
+    struct EasyListNode *children[2] = {retain_node(root),
+                                        new_path(leaf, *shift)};
+    *shift += EASY_LIST_BITS_PER_LEVEL;
+    return new_internal_node(children, 2, *shift);
+}
+
+/// @brief  Get a trie with the first n elements, where 0 < n <= size.
+static struct EasyListNode *
+take_node(struct EasyListNode *const node, unsigned const shift, size_t n)
+{
+    if (n == get_node_size(node, shift)) {
+        return retain_node(node);
+    } else if (shift == 0) {
+        return new_leaf_from_slice(node, 0, n);
+    }
+    struct EasyListNode *children[EASY_LIST_BRANCHING] = {0};
+    size_t last = n - 1;
+    size_t const idx = find_child(node, shift, &last);
+    for (size_t i = 0; i < idx; ++i) {
+        children[i] = retain_node(node->slots[i].child);
+    }
+    children[idx] = take_node(node->slots[idx].child,
+                              shift - EASY_LIST_BITS_PER_LEVEL,
+                              last + 1);
+    return new_internal_node(children, idx + 1, shift);
+}
+
+/// @brief  Get a trie without the first n elements, where 0 <= n < size.
+static struct EasyListNode *
+drop_node(struct EasyListNode *const node, unsigned const shift, size_t n)
+{
+    if (n == 0) {
+        return retain_node(node);
+    } else if (shift == 0) {
+        return new_leaf_from_slice(node, n, node->length);
+    }
+    struct EasyListNode *children[EASY_LIST_BRANCHING] = {0};
+    size_t first = n;
+    size_t const idx = find_child(node, shift, &first);
+    children[0] = drop_node(node->slots[idx].child,
+                            shift - EASY_LIST_BITS_PER_LEVEL,
+                            first);
+    for (size_t i = idx + 1; i < node->length; ++i) {
+        children[i - idx] = retain_node(node->slots[i].child);
+    }
+    return new_internal_node(children, node->length - idx, shift);
+}
+
+/// @brief  Remove the rightmost leaf, returning the new trie (or NULL if it
+///         would be empty). We take ownership of the node.
+static struct EasyListNode *
+pop_leaf(struct EasyListNode *const node,
+         unsigned const shift,
+         struct EasyListNode **const leaf)
+{
+    if (shift == 0) {
+        *leaf = node;
+        return NULL;
+    }
+    struct EasyListNode *children[EASY_LIST_BRANCHING] = {0};
+    size_t const last = node->length - 1;
+    for (size_t i = 0; i < last; ++i) {
+        children[i] = retain_node(node->slots[i].child);
+    }
+    struct EasyListNode *new_child =
+        pop_leaf(retain_node(node->slots[last].child),
+                 shift - EASY_LIST_BITS_PER_LEVEL,
+                 leaf);
+    size_t count = last;
+    if (new_child != NULL) {
+        children[count++] = new_child;
+    }
+    release_node(node, shift);
+    if (count == 0) {
+        return NULL;
+    }
+    return new_internal_node(children, count, shift);
+}
+
+/*******************************************************************************
+ *  CONCATENATION
+ ******************************************************************************/
+
+/// @brief  Decide how many slots each of the merged nodes should hold. We
+///         only redistribute slots if there are too many nodes, in which case
+///         we spill the first non-full nodes into their neighbours.
+/// Source: Bagwell and Rompf, "RRB-Trees: Efficient Immutable Vectors" (2011)
+static size_t
+plan_rebalance(size_t *const counts, size_t num_nodes)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < num_nodes; ++i) {
+        total += counts[i];
+    }
+    size_t const optimal =
+        (total + EASY_LIST_BRANCHING - 1) / EASY_LIST_BRANCHING;
+    size_t i = 0;
+    while (num_nodes > optimal + EASY_LIST_EXTRA_NODES) {
+        while (counts[i] > EASY_LIST_BRANCHING - EASY_LIST_EXTRA_NODES / 2) {
+            ++i;
+        }
+        size_t remaining = counts[i];
+        do {
+            EASY_ASSERT(i + 1 < num_nodes, "ran out of nodes to spill into");
+            size_t const size =
+                MIN(remaining + counts[i + 1], (size_t)EASY_LIST_BRANCHING);
+            counts[i] = size;
+            remaining = remaining + counts[i + 1] - size;
+            ++i;
+        } while (remaining > 0);
+        /* Node i was spilled, so we shift the later nodes down */
+        for (size_t j = i; j + 1 < num_nodes; ++j) {
+            counts[j] = counts[j + 1];
+        }
+        --num_nodes;
+        --i;
+    }
+    return num_nodes;
+}
+
+/// @brief  Merge the children of the left node (except the last), the middle
+///         node, and the right node (except the first). The left or right may
+///         be NULL. We return a node at (shift + 5) with 1 or 2 children.
+/// @note   We take ownership of the middle node.
+static struct EasyListNode *
+rebalance(struct EasyListNode const *const left,
+          struct EasyListNode *const middle,
+          struct EasyListNode const *const right,
+          unsigned const shift)
+{
+    unsigned const child_shift = shift - EASY_LIST_BITS_PER_LEVEL;
+    struct EasyListNode *all[2 * EASY_LIST_BRANCHING] = {0};
+    size_t counts[2 * EASY_LIST_BRANCHING] = {0};
+    size_t num_all = 0;
+    if (left != NULL) {
+        for (size_t i = 0; i + 1 < left->length; ++i) {
+            all[num_all++] = left->slots[i].child;
+        }
+    }
+    for (size_t i = 0; i < middle->length; ++i) {
+        all[num_all++] = middle->slots[i].child;
+    }
+    if (right != NULL) {
+        for (size_t i = 1; i < right->length; ++i) {
+            all[num_all++] = right->slots[i].child;
+        }
+    }
+    for (size_t i = 0; i < num_all; ++i) {
+        counts[i] = all[i]->length;
+    }
+    size_t const num_new = plan_rebalance(counts, num_all);
+
+    /* Build the new nodes, reusing the old ones where they are unchanged */
+    struct EasyListNode *new_all[2 * EASY_LIST_BRANCHING] = {0};
+    size_t src = 0, offset = 0;
+    for (size_t i = 0; i < num_new; ++i) {
+        if (offset == 0 && all[src]->length == counts[i]) {
+            new_all[i] = retain_node(all[src++]);
+            continue;
+        }
+        struct EasyListNode *children[EASY_LIST_BRANCHING] = {0};
+        struct EasyListNode *leaf =
+            child_shift == 0 ? new_node(counts[i], false) : NULL;
+        for (size_t j = 0; j < counts[i]; ++j) {
+            if (leaf != NULL) {
+                leaf->slots[leaf->length++].element =
+                    EasyGenericObject__copy(&all[src]->slots[offset].element);
+            } else {
+                children[j] = retain_node(all[src]->slots[offset].child);
+            }
+            if (++offset == all[src]->length) {
+                ++src;
+                offset = 0;
+            }
+        }
+        new_all[i] = leaf != NULL
+                         ? leaf
+                         : new_internal_node(children, counts[i], child_shift);
+    }
+    EASY_ASSERT(src == num_all && offset == 0, "must use every slot");
+    release_node(middle, shift);
+
+    struct EasyListNode *nodes[2] = {0};
+    size_t const num_left = MIN(num_new, (size_t)EASY_LIST_BRANCHING);
+    nodes[0] = new_internal_node(new_all, num_left, shift);
+    if (num_new == num_left) {
+        return new_internal_node(nodes, 1, shift + EASY_LIST_BITS_PER_LEVEL);
+    }
+    nodes[1] = new_internal_node(&new_all[num_left], num_new - num_left, shift);
+    return new_internal_node(nodes, 2, shift + EASY_LIST_BITS_PER_LEVEL);
+}
+
+/// @brief  Concatenate two tries, returning a node one level above the
+///         taller of the two. It has 1 or 2 children.
+static struct EasyListNode *
+concat_nodes(struct EasyListNode *const left,
+             unsigned const left_shift,
+             struct EasyListNode *const right,
+             unsigned const right_shift)
+{
+    if (left_shift > right_shift) {
+        struct EasyListNode *middle =
+            concat_nodes(left->slots[left->length - 1].child,
+                         left_shift - EASY_LIST_BITS_PER_LEVEL,
+                         right,
+                         right_shift);
+        return rebalance(left, middle, NULL, left_shift);
+    } else if (left_shift < right_shift) {
+        struct EasyListNode *middle =
+            concat_nodes(left,
+                         left_shift,
+                         right->slots[0].child,
+                         right_shift - EASY_LIST_BITS_PER_LEVEL);
+        return rebalance(NULL, middle, right, right_shift);
+    } else if (left_shift == 0) {
+        if (left->length + right->length > EASY_LIST_BRANCHING) {
+            struct EasyListNode *leaves[2] = {retain_node(left),
+                                              retain_node(right)};
+            return new_internal_node(leaves, 2, EASY_LIST_BITS_PER_LEVEL);
+        }
+        struct EasyListNode *leaf =
+            new_node(left->length + right->length, false);
+        for (size_t i = 0; i < left->length; ++i) {
+            leaf->slots[leaf->length++].element =
+                EasyGenericObject__copy(&left->slots[i].element);
+        }
+        for (size_t i = 0; i < right->length; ++i) {
+            leaf->slots[leaf->length++].element =
+                EasyGenericObject__copy(&right->slots[i].element);
+        }
+        return new_internal_node(&leaf, 1, EASY_LIST_BITS_PER_LEVEL);
+    }
+    struct EasyListNode *middle =
+        concat_nodes(left->slots[left->length - 1].child,
+                     left_shift - EASY_LIST_BITS_PER_LEVEL,
+                     right->slots[0].child,
+                     right_shift - EASY_LIST_BITS_PER_LEVEL);
+    return rebalance(left, middle, right, left_shift);
+}
+
+/*******************************************************************************
+ *  LIST
+ ******************************************************************************/
+
+/// @brief  Build a list from a trie and tail, taking ownership of both. We
+///         strip redundant levels and ensure that the tail is not empty.
+static struct EasyList
+new_list(struct EasyListNode *root,
+         unsigned shift,
+         struct EasyListNode *tail)
+{
+    while (root != NULL && shift > 0 && root->length == 1) {
+        struct EasyListNode *child = retain_node(root->slots[0].child);
+        release_node(root, shift);
+        root = child;
+        shift -= EASY_LIST_BITS_PER_LEVEL;
+    }
+    if (tail == NULL && root != NULL) {
+        root = pop_leaf(root, shift, &tail);
+        return new_list(root, root == NULL ? 0 : shift, tail);
+    }
+    size_t const length = (root == NULL ? 0 : get_node_size(root, shift)) +
+                          (tail == NULL ? 0 : tail->length);
+    return (struct EasyList){
+        .root = root,
+        .tail = tail,
+        .length = length,
+        .shift = root == NULL ? 0 : shift,
+    };
+}
+
+static size_t
+get_tail_offset(struct EasyList const *const me)
+{
+    return me->length - (me->tail == NULL ? 0 : me->tail->length);
+}
+
 struct EasyList
 EasyList__new_empty(void)
 {
-    return (struct EasyList){.data = EASY_MALLOC(0, 0), .length = 0};
+    return (struct EasyList){.root = NULL, .tail = NULL, .length = 0};
 }
 
 struct EasyList
 EasyList__append(struct EasyList const *const me,
                  struct EasyGenericObject const *const obj)
 {
-    struct EasyList new_item = {
-        .data = EASY_CALLOC(me->length + 1, sizeof(*me->data)),
-        .length = me->length + 1};
-    /* Recursively copy data */
-    for (size_t i = 0; i < me->length; ++i) {
-        new_item.data[i] = EasyGenericObject__copy(&me->data[i]);
+    EASY_GUARD(me != NULL && obj != NULL, "ptr must not be NULL");
+    if (me->tail != NULL && me->tail->length < EASY_LIST_BRANCHING) {
+        struct EasyListNode *tail = new_node(me->tail->length + 1, false);
+        for (size_t i = 0; i < me->tail->length; ++i) {
+            tail->slots[tail->length++].element =
+                EasyGenericObject__copy(&me->tail->slots[i].element);
+        }
+        tail->slots[tail->length++].element = EasyGenericObject__copy(obj);
+        return (struct EasyList){
+            .root = me->root == NULL ? NULL : retain_node(me->root),
+            .tail = tail,
+            .length = me->length + 1,
+            .shift = me->shift,
+        };
     }
-    new_item.data[me->length] = EasyGenericObject__copy(obj);
-    return new_item;
+
+    /* The tail is full, so we push it into the trie and start a new one */
+    unsigned shift = me->shift;
+    struct EasyListNode *root =
+        me->tail == NULL ? NULL
+                         : push_tail(me->root, &shift, retain_node(me->tail));
+    struct EasyListNode *tail = new_node(1, false);
+    tail->slots[tail->length++].element = EasyGenericObject__copy(obj);
+    return (struct EasyList){
+        .root = root,
+        .tail = tail,
+        .length = me->length + 1,
+        .shift = shift,
+    };
+}
+
+struct EasyGenericObject const *
+EasyList__get(struct EasyList const *const me, const size_t index)
+{
+    EASY_GUARD(me != NULL, "ptr must not be NULL");
+    EASY_GUARD(index < me->length, "index must fall within the list length");
+    size_t const tail_offset = get_tail_offset(me);
+    if (index >= tail_offset) {
+        return &me->tail->slots[index - tail_offset].element;
+    }
+    return get_element(me->root, me->shift, index);
 }
 
 struct EasyGenericObject
 EasyList__lookup(struct EasyList const *const me, const size_t index)
 {
-    EASY_GUARD(me != NULL && me->data != NULL, "ptr must not be NULL");
-    EASY_GUARD(index < me->length, "index must fall within the list length");
-    return EasyGenericObject__copy(&me->data[index]);
+    return EasyGenericObject__copy(EasyList__get(me, index));
 }
 
 struct EasyList
-EasyList__remove(struct EasyList const *const me, const size_t index)
+EasyList__slice(struct EasyList const *const me,
+                const size_t start,
+                const size_t end)
 {
-    EASY_GUARD(me != NULL && me->data != NULL, "ptr must not be NULL");
-    EASY_GUARD(index < me->length, "index must fall within the list length");
+    EASY_GUARD(me != NULL, "ptr must not be NULL");
+    EASY_GUARD(start <= end && end <= me->length, "invalid slice");
+    if (start == end) {
+        return EasyList__new_empty();
+    }
+    size_t const tail_offset = get_tail_offset(me);
+    if (start >= tail_offset) {
+        struct EasyListNode *tail = new_leaf_from_slice(me->tail,
+                                                        start - tail_offset,
+                                                        end - tail_offset);
+        return new_list(NULL, 0, tail);
+    } else if (end <= tail_offset) {
+        struct EasyListNode *prefix = take_node(me->root, me->shift, end);
+        struct EasyListNode *root = drop_node(prefix, me->shift, start);
+        release_node(prefix, me->shift);
+        return new_list(root, me->shift, NULL);
+    }
+    struct EasyListNode *root = drop_node(me->root, me->shift, start);
+    struct EasyListNode *tail =
+        end == me->length
+            ? retain_node(me->tail)
+            : new_leaf_from_slice(me->tail, 0, end - tail_offset);
+    return new_list(root, me->shift, tail);
+}
 
-    struct EasyList new_item = {
-        .data = EASY_CALLOC(me->length - 1, sizeof(*me->data)),
-        .length = me->length - 1};
+struct EasyList
+EasyList__concat(struct EasyList const *const me,
+                 struct EasyList const *const other)
+{
+    EASY_GUARD(me != NULL && other != NULL, "ptr must not be NULL");
+    if (me->length == 0) {
+        return EasyList__copy(other);
+    } else if (other->length == 0) {
+        return EasyList__copy(me);
+    }
 
-    size_t new_i = 0;
-    for (size_t my_i = 0; my_i < me->length; ++my_i) {
-        if (my_i == index) {
-            continue;
+    if (other->root == NULL &&
+        me->tail->length + other->tail->length <= EASY_LIST_BRANCHING) {
+        struct EasyListNode *tail =
+            new_node(me->tail->length + other->tail->length, false);
+        for (size_t i = 0; i < me->tail->length; ++i) {
+            tail->slots[tail->length++].element =
+                EasyGenericObject__copy(&me->tail->slots[i].element);
+        }
+        for (size_t i = 0; i < other->tail->length; ++i) {
+            tail->slots[tail->length++].element =
+                EasyGenericObject__copy(&other->tail->slots[i].element);
         }
-        printf("%zu -> %zu\n", new_i, my_i);
-        fflush(stdout);
-        new_item.data[new_i] = EasyGenericObject__copy(&me->data[my_i]);
-        ++new_i;
+        return new_list(me->root == NULL ? NULL : retain_node(me->root),
+                        me->shift,
+                        tail);
     }
+
+    /* Flush our tail into our trie so that the other tail stays at the end */
+    unsigned shift = me->shift;
+    struct EasyListNode *left =
+        push_tail(me->root, &shift, retain_node(me->tail));
+    if (other->root == NULL) {
+        return new_list(left, shift, retain_node(other->tail));
+    }
+    struct EasyListNode *root =
+        concat_nodes(left, shift, other->root, other->shift);
+    release_node(left, shift);
+    return new_list(root,
+                    MAX(shift, other->shift) + EASY_LIST_BITS_PER_LEVEL,
+                    retain_node(other->tail));
+}
+
+struct EasyList
+EasyList__remove(struct EasyList const *const me, const size_t index)
+{
+    EASY_GUARD(me != NULL, "ptr must not be NULL");
+    EASY_GUARD(index < me->length, "index must fall within the list length");
+    struct EasyList prefix = EasyList__slice(me, 0, index);
+    struct EasyList suffix = EasyList__slice(me, index + 1, me->length);
+    struct EasyList new_item = EasyList__concat(&prefix, &suffix);
+    EasyList__destroy(&prefix);
+    EasyList__destroy(&suffix);
     return new_item;
 }
 
 struct EasyList
 EasyList__copy(struct EasyList const *const me)
 {
-    struct EasyList new_item = {.data =
-                                    EASY_CALLOC(me->length, sizeof(*me->data)),
-                                .length = me->length};
-    /* Recursively copy data */
-    for (size_t i = 0; i < me->length; ++i) {
-        new_item.data[i] = EasyGenericObject__copy(&me->data[i]);
-    }
-    return new_item;
+    EASY_GUARD(me != NULL, "ptr must not be NULL");
+    /* The nodes are immutable, so we share them */
+    return (struct EasyList){
+        .root = me->root == NULL ? NULL : retain_node(me->root),
+        .tail = me->tail == NULL ? NULL : retain_node(me->tail),
+        .length = me->length,
+        .shift = me->shift,
+        .hash = __atomic_load_n(&me->hash, __ATOMIC_RELAXED),
+    };
 }
 
 void
 EasyList__destroy(struct EasyList *const me)
 {
-    EASY_GUARD(me != NULL && me->data != NULL, "ptr must not be NULL");
-    for (size_t i = 0; i < me->length; ++i) {
-        EasyGenericObject__destroy(&me->data[i]);
+    EASY_GUARD(me != NULL, "ptr must not be NULL");
+    if (me->root != NULL) {
+        release_node(me->root, me->shift);
+    }
+    if (me->tail != NULL) {
+        release_node(me->tail, 0);
     }
-    EASY_FREE(me->data);
     *me = (struct EasyList){0};
 }
 
@@ -92,10 +695,9 @@ void
 EasyList__print(struct EasyList const *const me)
 {
     EASY_GUARD(me != NULL, "pointer must not be NULL");
-    EASY_ASSERT(me->data != NULL, "me->data should not be NULL");
     printf("[");
     for (size_t i = 0; i < me->length; ++i) {
-        EasyGenericObject__print(&me->data[i]);
+        EasyGenericObject__print(EasyList__get(me, i));
         if (!is_last_element(i, me->length)) {
             printf(", ");
         }
@@ -107,15 +709,144 @@ void
 EasyList__print_json(struct EasyList const *const me)
 {
     EASY_GUARD(me != NULL, "pointer must not be NULL");
-    EASY_ASSERT(me->data != NULL, "me->data should not be NULL");
     printf("{\"type\": \"EasyList\", \".length\": %zu, \".data\": [",
            me->length);
 
     for (size_t i = 0; i < me->length; ++i) {
-        EasyGenericObject__print_json(&me->data[i]);
+        EasyGenericObject__print_json(EasyList__get(me, i));
         if (!is_last_element(i, me->length)) {
             printf(", ");
         }
     }
     printf("]}");
 }
+
+/*******************************************************************************
+ *  LIST BUILDER
+ ******************************************************************************/
+
+/// @brief  Wrap a leaf in single-child nodes with room to grow in place.
+static struct EasyListNode *
+new_builder_path(struct EasyListNode *const leaf, unsigned const shift)
+{
+    if (shift == 0) {
+        return leaf;
+    }
+    struct EasyListNode *node = new_node(EASY_LIST_BRANCHING, false);
+    node->slots[node->length++].child =
+        new_builder_path(leaf, shift - EASY_LIST_BITS_PER_LEVEL);
+    return node;
+}
+
+/// @brief  Push a full leaf into the builder's trie in place. The trie only
+///         ever holds full leaves, so it is balanced and we can navigate it by
+///         the index of the leaf's first element.
+static void
+push_tail_in_place(struct EasyListBuilder *const me,
+                   struct EasyListNode *const leaf)
+{
+    size_t const tree_length = me->length - leaf->length;
+    if (me->root == NULL) {
+        me->root = leaf;
+        me->shift = 0;
+        return;
+    } else if (tree_length == (size_t)EASY_LIST_BRANCHING << me->shift) {
+        /* The trie is full, so we grow a new level */
+        struct EasyListNode *root = new_node(EASY_LIST_BRANCHING, false);
+        root->slots[root->length++].child = me->root;
+        root->slots[root->length++].child = new_builder_path(leaf, me->shift);
+        me->root = root;
+        me->shift += EASY_LIST_BITS_PER_LEVEL;
+        return;
+    }
+    struct EasyListNode *node = me->root;
+    unsigned shift = me->shift;
+    while (true) {
+        size_t const idx =
+            (tree_length >> shift) & (EASY_LIST_BRANCHING - 1);
+        if (idx == node->length) {
+            node->slots[node->length++].child =
+                new_builder_path(leaf, shift - EASY_LIST_BITS_PER_LEVEL);
+            return;
+        }
+        node = node->slots[idx].child;
+        shift -= EASY_LIST_BITS_PER_LEVEL;
+    }
+}
+
+/// @brief  Release the unused slots of a node that the builder owns. We
+///         return the (possibly moved) node.
+static struct EasyListNode *
+shrink_node_in_place(struct EasyListNode *node)
+{
+    EASY_ASSERT(node->refcount == 1 && node->sizes == NULL,
+                "the builder must own the (balanced) node");
+    if (node->length == node->capacity) {
+        return node;
+    }
+    node = EASY_REALLOC(node,
+                        1,
+                        sizeof(struct EasyListNode) +
+                            node->length * sizeof(union EasyListSlot));
+    node->capacity = node->length;
+    return node;
+}
+
+struct EasyListBuilder
+EasyListBuilder__new_empty(void)
+{
+    return (struct EasyListBuilder){0};
+}
+
+void
+EasyListBuilder__append(struct EasyListBuilder *const me,
+                        struct EasyGenericObject const *const obj)
+{
+    EASY_GUARD(me != NULL && obj != NULL, "ptr must not be NULL");
+    if (me->tail != NULL && me->tail->length == EASY_LIST_BRANCHING) {
+        push_tail_in_place(me, me->tail);
+        me->tail = NULL;
+    }
+    if (me->tail == NULL) {
+        me->tail = new_node(EASY_LIST_BRANCHING, false);
+    }
+    me->tail->slots[me->tail->length++].element = EasyGenericObject__copy(obj);
+    ++me->length;
+}
+
+struct EasyList
+EasyListBuilder__freeze(struct EasyListBuilder *const me)
+{
+    EASY_GUARD(me != NULL, "ptr must not be NULL");
+    /* The builder allocates every node at full width, but only the tail and
+     * the rightmost path of the trie may be partly full */
+    if (me->tail != NULL) {
+        me->tail = shrink_node_in_place(me->tail);
+    }
+    if (me->root != NULL) {
+        me->root = shrink_node_in_place(me->root);
+        struct EasyListNode *node = me->root;
+        for (unsigned shift = me->shift; shift > 0;
+             shift -= EASY_LIST_BITS_PER_LEVEL) {
+            union EasyListSlot *const last = &node->slots[node->length - 1];
+            last->child = shrink_node_in_place(last->child);
+            node = last->child;
+        }
+    }
+    struct EasyList list = {
+        .root = me->root,
+        .tail = me->tail,
+        .length = me->length,
+        .shift = me->shift,
+    };
+    *me = EasyListBuilder__new_empty();
+    return list;
+}
+
+void
+EasyListBuilder__destroy(struct EasyListBuilder *const me)
+{
+    EASY_GUARD(me != NULL, "ptr must not be NULL");
+    struct EasyList list = EasyListBuilder__freeze(me);
+    EasyList__destroy(&list);
+}
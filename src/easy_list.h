@@ -1,12 +1,22 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 struct EasyGenericObject;
+struct EasyListNode;
 
+/* EasyList
+ * This is a persistent relaxed radix balanced (RRB) vector. The last few
+ * elements live in a separate "tail" leaf so that appending is amortized
+ * O(1). Looking up an element is O(log32 n), and removing, slicing, and
+ * concatenating share structure with the original lists. */
 struct EasyList {
-    struct EasyGenericObject *data;
+    struct EasyListNode *root; /* All but the tail (NULL if it is empty) */
+    struct EasyListNode *tail; /* The last 1-32 elements (NULL if empty) */
     size_t length;
+    unsigned shift; /* Number of index bits below the root (0 for a leaf) */
+    uint64_t hash;  /* The memoised hash (zero until we first compute it) */
 };
 
 struct EasyList
@@ -16,8 +26,19 @@ EasyList__append(struct EasyList const *const me,
                  struct EasyGenericObject const *const obj);
 struct EasyGenericObject
 EasyList__lookup(struct EasyList const *const me, const size_t index);
+/// @brief  Borrow an element (the list maintains ownership).
+struct EasyGenericObject const *
+EasyList__get(struct EasyList const *const me, const size_t index);
 struct EasyList
 EasyList__remove(struct EasyList const *const me, const size_t index);
+/// @brief  Get the elements in [start, end).
+struct EasyList
+EasyList__slice(struct EasyList const *const me,
+                const size_t start,
+                const size_t end);
+struct EasyList
+EasyList__concat(struct EasyList const *const me,
+                 struct EasyList const *const other);
 struct EasyList
 EasyList__copy(struct EasyList const *const me);
 void
@@ -27,3 +48,25 @@ void
 EasyList__print(struct EasyList const *const me);
 void
 EasyList__print_json(struct EasyList const *const me);
+
+/* EasyListBuilder
+ * This is explicitly Mutable. It appends elements in place, without creating
+ * an intermediate version per element. Freezing it hands the trie over to a
+ * regular EasyList in O(1) and leaves the builder empty.
+ */
+struct EasyListBuilder {
+    struct EasyListNode *root; /* Every node is owned solely by the builder */
+    struct EasyListNode *tail;
+    size_t length;
+    unsigned shift;
+};
+
+struct EasyListBuilder
+EasyListBuilder__new_empty(void);
+void
+EasyListBuilder__append(struct EasyListBuilder *const me,
+                        struct EasyGenericObject const *const obj);
+struct EasyList
+EasyListBuilder__freeze(struct EasyListBuilder *const me);
+void
+EasyListBuilder__destroy(struct EasyListBuilder *const me);
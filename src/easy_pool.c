@@ -0,0 +1,303 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "easy_common.h"
+
+#include "easy_pool.h"
+
+/* We round small sizes up to a multiple of the class size, so the classes are
+ * 16, 32, ..., 256 bytes. Anything larger goes to malloc. */
+#define EASY_POOL_CLASS_SIZE  16
+#define EASY_POOL_NUM_CLASSES 16
+#define EASY_POOL_MAX_SIZE    (EASY_POOL_CLASS_SIZE * EASY_POOL_NUM_CLASSES)
+#define EASY_POOL_SLAB_SIZE   ((size_t)64 * 1024)
+/* The size class of an allocation that we got straight from malloc */
+#define EASY_POOL_LARGE SIZE_MAX
+
+union EasyPoolHeader {
+    size_t size_class; /* Index of the size class, or EASY_POOL_LARGE */
+    union EasyMaxAlign align;
+};
+
+/* A free chunk stores the link to the next free chunk just after its header */
+struct EasyPoolFreeChunk {
+    struct EasyPoolFreeChunk *next;
+};
+
+struct EasyPoolSlab {
+    struct EasyPoolSlab *next;
+    union EasyPoolHeader data[];
+};
+
+struct EasyPoolClass {
+    struct EasyPoolFreeChunk *free_list;
+    /* The part of the newest slab that we have not carved up yet */
+    char *bump;
+    char *end;
+    struct EasyPoolSlab *slabs; /* Keep the slabs reachable for leak checkers */
+};
+
+#ifndef EASY_POOL_DISABLE
+static __thread struct EasyPoolClass pools[EASY_POOL_NUM_CLASSES];
+
+/* When a thread exits, we hand its free chunks and its slabs to these pools.
+ * A thread adopts them before it carves a new slab, so the memory is reused
+ * rather than lost (and the slabs stay reachable). */
+static pthread_mutex_t orphans_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct EasyPoolClass orphans[EASY_POOL_NUM_CLASSES];
+static pthread_once_t exit_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t exit_key;
+static __thread bool is_registered = false;
+#endif
+
+static size_t
+get_class_size(size_t const size_class)
+{
+    return (size_class + 1) * EASY_POOL_CLASS_SIZE;
+}
+
+static size_t
+get_size_class(size_t const num_bytes)
+{
+#ifdef EASY_POOL_DISABLE
+    (void)num_bytes;
+    return EASY_POOL_LARGE;
+#else
+    if (num_bytes > EASY_POOL_MAX_SIZE) {
+        return EASY_POOL_LARGE;
+    }
+    return num_bytes == 0 ? 0 : (num_bytes - 1) / EASY_POOL_CLASS_SIZE;
+#endif
+}
+
+static union EasyPoolHeader *
+get_header(void const *const ptr)
+{
+    EASY_GUARD(ptr != NULL, "pointer must not be NULL");
+    return (union EasyPoolHeader *)ptr - 1;
+}
+
+static void *
+alloc_large(size_t const num_bytes)
+{
+    if (num_bytes >= SIZE_MAX - sizeof(union EasyPoolHeader)) {
+        return NULL;
+    }
+    union EasyPoolHeader *header = calloc(1, sizeof(*header) + num_bytes);
+    if (header == NULL) {
+        return NULL;
+    }
+    header->size_class = EASY_POOL_LARGE;
+    return header + 1;
+}
+
+#ifndef EASY_POOL_DISABLE
+static size_t
+get_chunk_size(size_t const size_class)
+{
+    return sizeof(union EasyPoolHeader) + get_class_size(size_class);
+}
+
+static bool
+has_room(struct EasyPoolClass const *const pool, size_t const size_class)
+{
+    return pool->bump != NULL &&
+           (size_t)(pool->end - pool->bump) >= get_chunk_size(size_class);
+}
+
+/// @brief  Carve a chunk out of the newest slab, which must have room.
+static union EasyPoolHeader *
+carve_from_slab(struct EasyPoolClass *const pool, size_t const size_class)
+{
+    union EasyPoolHeader *header = (union EasyPoolHeader *)pool->bump;
+    pool->bump += get_chunk_size(size_class);
+    header->size_class = size_class;
+    return header;
+}
+
+static struct EasyPoolSlab **
+get_last_slab_link(struct EasyPoolSlab **link)
+{
+    while (*link != NULL) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+/// @brief  Hand an exiting thread's pools over to the orphans.
+static void
+orphan_pools(void *const arg)
+{
+    struct EasyPoolClass *const thread_pools = arg;
+    EASY_ASSERT(pthread_mutex_lock(&orphans_lock) == 0, "cannot lock");
+    for (size_t i = 0; i < EASY_POOL_NUM_CLASSES; ++i) {
+        struct EasyPoolClass *const pool = &thread_pools[i];
+        struct EasyPoolClass *const orphan = &orphans[i];
+        /* Free the rest of the newest slab, so that whoever adopts the
+         * chunks need not track it */
+        struct EasyPoolFreeChunk *list = orphan->free_list;
+        while (has_room(pool, i)) {
+            struct EasyPoolFreeChunk *const chunk =
+                (struct EasyPoolFreeChunk *)(carve_from_slab(pool, i) + 1);
+            chunk->next = list;
+            list = chunk;
+        }
+        if (pool->free_list != NULL) {
+            struct EasyPoolFreeChunk *tail = pool->free_list;
+            while (tail->next != NULL) {
+                tail = tail->next;
+            }
+            tail->next = list;
+            list = pool->free_list;
+        }
+        orphan->free_list = list;
+        *get_last_slab_link(&orphan->slabs) = pool->slabs;
+        *pool = (struct EasyPoolClass){0};
+    }
+    EASY_ASSERT(pthread_mutex_unlock(&orphans_lock) == 0, "cannot unlock");
+    /* Register again if a later destructor allocates */
+    is_registered = false;
+}
+
+static void
+create_exit_key(void)
+{
+    EASY_ASSERT(pthread_key_create(&exit_key, orphan_pools) == 0,
+                "cannot create the thread exit key");
+}
+
+/// @brief  Make sure that we orphan this thread's pools when it exits.
+static void
+register_thread(void)
+{
+    if (is_registered) {
+        return;
+    }
+    EASY_ASSERT(pthread_once(&exit_key_once, create_exit_key) == 0,
+                "cannot create the thread exit key");
+    EASY_ASSERT(pthread_setspecific(exit_key, pools) == 0,
+                "cannot register the thread");
+    is_registered = true;
+}
+
+/// @brief  Take over the chunks and slabs that exited threads left behind.
+static void
+adopt_orphans(struct EasyPoolClass *const pool, size_t const size_class)
+{
+    EASY_ASSERT(pthread_mutex_lock(&orphans_lock) == 0, "cannot lock");
+    struct EasyPoolClass *const orphan = &orphans[size_class];
+    if (orphan->free_list != NULL) {
+        EASY_ASSERT(pool->free_list == NULL, "we only adopt when we run out");
+        pool->free_list = orphan->free_list;
+        *get_last_slab_link(&orphan->slabs) = pool->slabs;
+        pool->slabs = orphan->slabs;
+        *orphan = (struct EasyPoolClass){0};
+    }
+    EASY_ASSERT(pthread_mutex_unlock(&orphans_lock) == 0, "cannot unlock");
+}
+
+/// @brief  Carve a chunk out of the newest slab, starting a new slab if it is
+///         full. Slabs come from calloc, so these chunks are already zeroed.
+static union EasyPoolHeader *
+carve_chunk(struct EasyPoolClass *const pool, size_t const size_class)
+{
+    if (!has_room(pool, size_class)) {
+        struct EasyPoolSlab *slab =
+            calloc(1, sizeof(*slab) + EASY_POOL_SLAB_SIZE);
+        if (slab == NULL) {
+            return NULL;
+        }
+        register_thread();
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        pool->bump = (char *)slab->data;
+        pool->end = pool->bump + EASY_POOL_SLAB_SIZE;
+    }
+    return carve_from_slab(pool, size_class);
+}
+#endif
+
+void *
+EasyPool__alloc(size_t const num_bytes)
+{
+    size_t const size_class = get_size_class(num_bytes);
+    if (size_class == EASY_POOL_LARGE) {
+        return alloc_large(num_bytes);
+    }
+#ifdef EASY_POOL_DISABLE
+    EASY_IMPOSSIBLE();
+    return NULL;
+#else
+    struct EasyPoolClass *const pool = &pools[size_class];
+    union EasyPoolHeader *header = NULL;
+    if (pool->free_list == NULL && !has_room(pool, size_class)) {
+        adopt_orphans(pool, size_class);
+    }
+    if (pool->free_list != NULL) {
+        struct EasyPoolFreeChunk *const chunk = pool->free_list;
+        pool->free_list = chunk->next;
+        header = get_header(chunk);
+        memset(chunk, 0, num_bytes);
+    } else {
+        header = carve_chunk(pool, size_class);
+        if (header == NULL) {
+            return NULL;
+        }
+    }
+    header->size_class = size_class;
+    return header + 1;
+#endif
+}
+
+void *
+EasyPool__realloc(void *const ptr, size_t const num_bytes)
+{
+    union EasyPoolHeader *const header = get_header(ptr);
+    size_t const old_class = header->size_class;
+    size_t const new_class = get_size_class(num_bytes);
+    if (old_class == EASY_POOL_LARGE && new_class == EASY_POOL_LARGE) {
+        if (num_bytes >= SIZE_MAX - sizeof(union EasyPoolHeader)) {
+            return NULL;
+        }
+        union EasyPoolHeader *const new_header =
+            realloc(header, sizeof(*header) + num_bytes);
+        return new_header == NULL ? NULL : new_header + 1;
+    } else if (old_class == new_class) {
+        return ptr;
+    }
+    void *const new_ptr = EasyPool__alloc(num_bytes);
+    if (new_ptr == NULL) {
+        return NULL;
+    }
+    /* A large allocation only moves to a pool when it shrinks */
+    size_t const old_size =
+        old_class == EASY_POOL_LARGE ? num_bytes : get_class_size(old_class);
+    memcpy(new_ptr, ptr, MIN(old_size, num_bytes));
+    EasyPool__free(ptr);
+    return new_ptr;
+}
+
+void
+EasyPool__free(void *const ptr)
+{
+    union EasyPoolHeader *const header = get_header(ptr);
+    size_t const size_class = header->size_class;
+    if (size_class == EASY_POOL_LARGE) {
+        free(header);
+        return;
+    }
+#ifdef EASY_POOL_DISABLE
+    EASY_IMPOSSIBLE();
+#else
+    EASY_ASSERT(size_class < EASY_POOL_NUM_CLASSES, "corrupt pool header");
+    register_thread();
+    struct EasyPoolClass *const pool = &pools[size_class];
+    struct EasyPoolFreeChunk *const chunk = ptr;
+    chunk->next = pool->free_list;
+    pool->free_list = chunk;
+#endif
+}
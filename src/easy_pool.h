@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+
+/* EasyPool
+ * Small allocations come from per-size-class pools rather than from malloc.
+ * Each pool carves large slabs into equal chunks and recycles freed chunks
+ * through a free list, so our many small, fixed-size objects (e.g. table items
+ * and trie nodes) neither pay for malloc's bookkeeping nor fragment the heap.
+ *
+ * Each thread has its own pools, so we need no locks. A chunk may be freed on
+ * any thread: it simply joins that thread's pool. When a thread exits, we hand
+ * its chunks and slabs to the other threads, which adopt them before they
+ * carve new slabs. We never return the slabs to the system.
+ *
+ * NOTE Recycled chunks would hide use-after-free bugs from AddressSanitizer, so
+ *      we send every allocation to malloc when it is enabled (or when we define
+ *      EASY_POOL_DISABLE).
+ */
+#if defined(__SANITIZE_ADDRESS__) && !defined(EASY_POOL_DISABLE)
+#define EASY_POOL_DISABLE
+#endif
+
+/// @brief  Allocate zeroed memory, or return NULL if we are out of memory.
+void *
+EasyPool__alloc(size_t const num_bytes);
+/// @brief  Resize an allocation from EasyPool__alloc, or return NULL (leaving
+///         the original allocation intact) if we are out of memory. Unlike
+///         realloc, a NULL pointer is not allowed.
+void *
+EasyPool__realloc(void *const ptr, size_t const num_bytes);
+void
+EasyPool__free(void *const ptr);
@@ -1,5 +1,9 @@
+#include <inttypes.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "easy_common.h"
 #include "easy_equal.h"
@@ -9,116 +13,490 @@
 #include "easy_table.h"
 #include "easy_table_item.h"
 
-static bool
-is_last_element(size_t i, size_t length)
+/*******************************************************************************
+ *  TABLE ITEMS
+ ******************************************************************************/
+
+/// @brief  Mix the key and value hashes so that the sum of many entry hashes
+///         is still well distributed.
+static uint64_t
+get_entry_hash(uint64_t const key_hash,
+               struct EasyGenericObject const *const value)
 {
-    return i == length - 1;
+    uint64_t const value_hash = EasyGenericObject__hash(value);
+    struct EasyHashState state = EasyHashState__new(EasyHash__seed());
+    EasyHashState__update(&state, &key_hash, sizeof(key_hash));
+    EasyHashState__update(&state, &value_hash, sizeof(value_hash));
+    return EasyHashState__digest(&state);
 }
 
-struct EasyTable
-EasyTable__new_empty(void)
+static struct EasyTableItem *
+new_item(uint64_t const hash,
+         size_t const order,
+         struct EasyGenericObject const *const key,
+         struct EasyGenericObject const *const value)
 {
-    struct EasyTable new_item = {.data = NULL, .length = 0, .capacity = 0};
-    return new_item;
+    struct EasyTableItem *item = EASY_MALLOC(1, sizeof(*item));
+    *item = (struct EasyTableItem){.refcount = 1,
+                                   .hash = hash,
+                                   .entry_hash = get_entry_hash(hash, value),
+                                   .order = order,
+                                   .key = EasyGenericObject__copy(key),
+                                   .value = EasyGenericObject__copy(value)};
+    return item;
+}
+
+static struct EasyTableItem *
+retain_item(struct EasyTableItem *const item)
+{
+    EASY_GUARD(item != NULL &&
+                   __atomic_load_n(&item->refcount, __ATOMIC_RELAXED) != 0,
+               "invalid item");
+    __atomic_add_fetch(&item->refcount, 1, __ATOMIC_RELAXED);
+    return item;
+}
+
+static void
+release_item(struct EasyTableItem *const item)
+{
+    EASY_GUARD(item != NULL &&
+                   __atomic_load_n(&item->refcount, __ATOMIC_RELAXED) != 0,
+               "invalid item");
+    if (__atomic_sub_fetch(&item->refcount, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    EasyGenericObject__destroy(&item->key);
+    EasyGenericObject__destroy(&item->value);
+    EASY_FREE(item);
+}
+
+/// @brief  Sort items by their insertion order (for qsort).
+static int
+compare_item_order(void const *const lhs, void const *const rhs)
+{
+    struct EasyTableItem const *const a =
+        *(struct EasyTableItem const *const *)lhs;
+    struct EasyTableItem const *const b =
+        *(struct EasyTableItem const *const *)rhs;
+    return (a->order > b->order) - (a->order < b->order);
 }
 
-/// @brief  This function is to remind future developers to always check
-///         for a hash table with zero capacity. This means that the
-///         key cannot possibly be in the table nor can it be inserted.
 static bool
-is_capacity_zero(struct EasyTable const *const me)
+is_matching_item(struct EasyTableItem const *const item,
+                 struct EasyGenericObject const *const key,
+                 uint64_t const hash)
 {
-    EASY_GUARD(me != NULL, "inputs must not be NULL");
-    return me->capacity == 0;
+    return item->hash == hash && EasyGenericObject__equal(key, &item->key);
 }
 
+/*******************************************************************************
+ *  TRIE NODES
+ ******************************************************************************/
+
+/// @brief  Once we have consumed all of the hash bits, every key in the node
+///         has an identical hash and we must compare them one by one.
 static bool
-is_enough_room(struct EasyTable const *const me)
-{
-    EASY_GUARD(me != NULL, "inputs must not be NULL");
-    // NOTE According to Wikipedia, linear probing works very well until
-    //      about a load factor of 0.7-0.8. Source:
-    //      https://en.wikipedia.org/wiki/Hash_table
-    return 0.7 * me->capacity > me->length;
-}
-
-struct IndexStatus {
-    bool found;
-    size_t idx;
-};
-
-/// @brief  Get the position of the object or return the next empty/tombstone
-///         position if not found.
-static struct IndexStatus
-get_wouldbe_position(struct EasyTable const *const me,
-                     struct EasyGenericObject const *const key,
-                     uint64_t const hash)
-{
-    EASY_GUARD(me != NULL && key != NULL, "inputs must not be NULL");
-    EASY_GUARD(me->capacity != 0, "division by zero");
-    size_t home = hash % me->capacity;
-    for (size_t i = 0; i < me->capacity; ++i) {
-        size_t const idx = (home + i) % me->capacity;
-        switch (me->data[idx].valid) {
-        case EASY_TABLE_INVALID:
-            return (struct IndexStatus){.found = false, .idx = idx};
-        case EASY_TABLE_TOMBSTONE:
+is_collision_level(unsigned const shift)
+{
+    return shift >= EASY_TABLE_HASH_BITS;
+}
+
+static size_t
+hash_fragment(uint64_t const hash, unsigned const shift)
+{
+    EASY_ASSERT(!is_collision_level(shift), "shift out of range");
+    return (size_t)((hash >> shift) & EASY_TABLE_LEVEL_MASK);
+}
+
+static uint32_t
+hash_bit(uint64_t const hash, unsigned const shift)
+{
+    return (uint32_t)1 << hash_fragment(hash, shift);
+}
+
+/// @brief  Get the tag that we store in the node for an item's hash. We take
+///         the top bits, since the trie consumes the hash from the bottom up.
+static uint8_t
+hash_tag(uint64_t const hash)
+{
+    return (uint8_t)(hash >> (EASY_TABLE_HASH_BITS - EASY_TABLE_TAG_BITS));
+}
+
+static void
+set_tag(struct EasyTableNode *const node,
+        uint64_t const hash,
+        unsigned const shift)
+{
+    node->tags[hash_fragment(hash, shift)] = hash_tag(hash);
+}
+
+/// @brief  Check whether the item at the hash's fragment may match the hash.
+///         This is false for all but 1/256 of the mismatching items, so we can
+///         usually skip loading the item (and comparing its key) entirely.
+static bool
+has_matching_tag(struct EasyTableNode const *const node,
+                 uint64_t const hash,
+                 unsigned const shift)
+{
+    return node->tags[hash_fragment(hash, shift)] == hash_tag(hash);
+}
+
+/// @brief  Count the set bits in the bitmap below the given bit. This is the
+///         index into the dense array of items (or nodes).
+static size_t
+bitmap_index(uint32_t const bitmap, uint32_t const bit)
+{
+    return (size_t)__builtin_popcount(bitmap & (bit - 1));
+}
+
+static struct EasyTableNode *
+new_node(size_t const num_items, size_t const num_nodes)
+{
+    size_t const size =
+        sizeof(struct EasyTableNode) +
+        (num_items + num_nodes) * sizeof(((struct EasyTableNode *)0)->slots[0]);
+    struct EasyTableNode *node = EASY_MALLOC(1, size);
+    node->refcount = 1;
+    node->item_bitmap = 0;
+    node->node_bitmap = 0;
+    memset(node->tags, 0, sizeof(node->tags));
+    node->num_items = num_items;
+    node->num_nodes = num_nodes;
+    node->capacity = num_items + num_nodes;
+    return node;
+}
+
+static struct EasyTableNode *
+retain_node(struct EasyTableNode *const node)
+{
+    EASY_GUARD(node != NULL &&
+                   __atomic_load_n(&node->refcount, __ATOMIC_RELAXED) != 0,
+               "invalid node");
+    __atomic_add_fetch(&node->refcount, 1, __ATOMIC_RELAXED);
+    return node;
+}
+
+static void
+release_node(struct EasyTableNode *const node)
+{
+    EASY_GUARD(node != NULL &&
+                   __atomic_load_n(&node->refcount, __ATOMIC_RELAXED) != 0,
+               "invalid node");
+    if (__atomic_sub_fetch(&node->refcount, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    for (size_t i = 0; i < node->num_items; ++i) {
+        release_item(node->slots[i].item);
+    }
+    for (size_t i = 0; i < node->num_nodes; ++i) {
+        release_node(node->slots[node->num_items + i].node);
+    }
+    EASY_FREE(node);
+}
+
+static struct EasyTableItem *
+get_item(struct EasyTableNode const *const node, size_t const idx)
+{
+    EASY_ASSERT(idx < node->num_items, "item index out of range");
+    return node->slots[idx].item;
+}
+
+static struct EasyTableNode *
+get_child(struct EasyTableNode const *const node, size_t const idx)
+{
+    EASY_ASSERT(idx < node->num_nodes, "node index out of range");
+    return node->slots[node->num_items + idx].node;
+}
+
+/// @brief  Copy a node, skipping or inserting a slot in the items or nodes.
+/// @note   Every shared item and child node is retained by the copy.
+/// @param  item_idx    Index of the item to insert/remove, or SIZE_MAX.
+/// @param  node_idx    Index of the node to insert/remove, or SIZE_MAX.
+/// @param  item_delta  One of {-1, 0, +1}; the inserted item is left unset.
+/// @param  node_delta  One of {-1, 0, +1}; the inserted node is left unset.
+static struct EasyTableNode *
+copy_node_with_gaps(struct EasyTableNode const *const me,
+                    size_t const item_idx,
+                    int const item_delta,
+                    size_t const node_idx,
+                    int const node_delta)
+{
+    struct EasyTableNode *node = new_node(me->num_items + item_delta,
+                                          me->num_nodes + node_delta);
+    node->item_bitmap = me->item_bitmap;
+    node->node_bitmap = me->node_bitmap;
+    memcpy(node->tags, me->tags, sizeof(node->tags));
+
+    for (size_t src = 0, dst = 0; src < me->num_items; ++src, ++dst) {
+        if (src == item_idx && item_delta < 0) {
+            --dst;
             continue;
-        case EASY_TABLE_VALID:
-            if (EasyGenericObject__equal(key, &me->data[idx].key)) {
-                return (struct IndexStatus){.found = true, .idx = idx};
-            }
+        }
+        if (src == item_idx && item_delta > 0) {
+            ++dst;
+        }
+        node->slots[dst].item = retain_item(get_item(me, src));
+    }
+    for (size_t src = 0, dst = 0; src < me->num_nodes; ++src, ++dst) {
+        if (src == node_idx && node_delta < 0) {
+            --dst;
             continue;
-        default:
-            EASY_IMPOSSIBLE();
         }
+        if (src == node_idx && node_delta > 0) {
+            ++dst;
+        }
+        node->slots[node->num_items + dst].node =
+            retain_node(get_child(me, src));
+    }
+    return node;
+}
+
+/// @brief  Build the smallest subtrie holding two items with different keys.
+static struct EasyTableNode *
+merge_items(struct EasyTableItem *const a,
+            struct EasyTableItem *const b,
+            unsigned const shift)
+{
+    if (is_collision_level(shift)) {
+        EASY_ASSERT(a->hash == b->hash, "only identical hashes collide");
+        struct EasyTableNode *node = new_node(2, 0);
+        node->slots[0].item = a;
+        node->slots[1].item = b;
+        return node;
+    }
+
+    uint32_t const a_bit = hash_bit(a->hash, shift);
+    uint32_t const b_bit = hash_bit(b->hash, shift);
+    if (a_bit == b_bit) {
+        struct EasyTableNode *node = new_node(0, 1);
+        node->node_bitmap = a_bit;
+        node->slots[0].node =
+            merge_items(a, b, shift + EASY_TABLE_BITS_PER_LEVEL);
+        return node;
+    }
+    struct EasyTableNode *node = new_node(2, 0);
+    node->item_bitmap = a_bit | b_bit;
+    set_tag(node, a->hash, shift);
+    set_tag(node, b->hash, shift);
+    node->slots[a_bit < b_bit ? 0 : 1].item = a;
+    node->slots[a_bit < b_bit ? 1 : 0].item = b;
+    return node;
+}
+
+/// @brief  Return a new node with the item inserted (or its value replaced).
+/// @note   We take ownership of the item.
+/// @param  replaced    Set to the item we replaced, if any. The original node
+///                     still holds a reference to it.
+static struct EasyTableNode *
+insert_node(struct EasyTableNode const *const me,
+            struct EasyTableItem *const item,
+            unsigned const shift,
+            struct EasyTableItem const **const replaced)
+{
+    if (is_collision_level(shift)) {
+        for (size_t i = 0; i < me->num_items; ++i) {
+            if (is_matching_item(get_item(me, i), &item->key, item->hash)) {
+                struct EasyTableNode *node =
+                    copy_node_with_gaps(me, SIZE_MAX, 0, SIZE_MAX, 0);
+                release_item(node->slots[i].item);
+                node->slots[i].item = item;
+                *replaced = get_item(me, i);
+                return node;
+            }
+        }
+        struct EasyTableNode *node =
+            copy_node_with_gaps(me, me->num_items, +1, SIZE_MAX, 0);
+        node->slots[me->num_items].item = item;
+        return node;
     }
 
-    // The hash table is probably full!
-    return (struct IndexStatus){.found = false, .idx = me->capacity};
+    uint32_t const bit = hash_bit(item->hash, shift);
+    if (me->item_bitmap & bit) {
+        size_t const idx = bitmap_index(me->item_bitmap, bit);
+        struct EasyTableItem *const old_item = get_item(me, idx);
+        if (has_matching_tag(me, item->hash, shift) &&
+            is_matching_item(old_item, &item->key, item->hash)) {
+            struct EasyTableNode *node =
+                copy_node_with_gaps(me, SIZE_MAX, 0, SIZE_MAX, 0);
+            release_item(node->slots[idx].item);
+            node->slots[idx].item = item;
+            *replaced = old_item;
+            return node;
+        }
+        /* Push both items down into a new subtrie */
+        size_t const node_idx = bitmap_index(me->node_bitmap, bit);
+        struct EasyTableNode *node =
+            copy_node_with_gaps(me, idx, -1, node_idx, +1);
+        node->item_bitmap &= ~bit;
+        node->node_bitmap |= bit;
+        node->slots[node->num_items + node_idx].node =
+            merge_items(retain_item(old_item),
+                        item,
+                        shift + EASY_TABLE_BITS_PER_LEVEL);
+        return node;
+    } else if (me->node_bitmap & bit) {
+        size_t const node_idx = bitmap_index(me->node_bitmap, bit);
+        struct EasyTableNode *const child =
+            insert_node(get_child(me, node_idx),
+                        item,
+                        shift + EASY_TABLE_BITS_PER_LEVEL,
+                        replaced);
+        struct EasyTableNode *node =
+            copy_node_with_gaps(me, SIZE_MAX, 0, SIZE_MAX, 0);
+        release_node(node->slots[node->num_items + node_idx].node);
+        node->slots[node->num_items + node_idx].node = child;
+        return node;
+    } else {
+        size_t const idx = bitmap_index(me->item_bitmap, bit);
+        struct EasyTableNode *node =
+            copy_node_with_gaps(me, idx, +1, SIZE_MAX, 0);
+        node->item_bitmap |= bit;
+        set_tag(node, item->hash, shift);
+        node->slots[idx].item = item;
+        return node;
+    }
 }
 
-static struct EasyTable
-new_empty_table_with_capacity(uint64_t const capacity)
+static bool
+is_empty_node(struct EasyTableNode const *const me)
 {
-    struct EasyTable new_item = {
-        .data = EASY_CALLOC(capacity, sizeof(*new_item.data)),
-        .length = 0,
-        .capacity = capacity};
-    return new_item;
+    return me->num_items == 0 && me->num_nodes == 0;
 }
 
-static struct EasyTable
-resize_table(struct EasyTable const *const me, uint64_t const capacity)
-{
-    EASY_GUARD(capacity >= me->length, "capacity must be large enough to hold");
-
-    EasyTable__print_json(me);
-    printf("\n");
-
-    struct EasyTable new_table = new_empty_table_with_capacity(capacity);
-    EasyTable__print_json(&new_table);
-    printf("\n");
-    for (size_t i = 0; i < me->capacity; ++i) {
-        if (me->data[i].valid == EASY_TABLE_VALID) {
-            struct EasyGenericObject const *const key = &me->data[i].key;
-            uint64_t const hash = me->data[i].hash;
-            struct EasyGenericObject const *const value = &me->data[i].value;
-
-            struct IndexStatus const status =
-                get_wouldbe_position(&new_table, key, hash);
-            EASY_ASSERT(is_enough_room(&new_table), "ran out of room");
-            EASY_ASSERT(!status.found, "should not have found the key");
-            new_table.data[status.idx] =
-                (struct EasyTableItem){.valid = EASY_TABLE_VALID,
-                                       .hash = hash,
-                                       .key = EasyGenericObject__copy(key),
-                                       .value = EasyGenericObject__copy(value)};
-            ++new_table.length;
+/// @brief  Return a new node without the key, or NULL if the node would be
+///         empty. If the key is not found, we return the original node.
+/// @note   We never leave a subtrie that holds a single item, so the trie has
+///         the same shape as if we had never inserted the key.
+/// Source: Steindorfer and Vinju, "Optimizing Hash-Array Mapped Tries for Fast
+///         and Lean Immutable JVM Collections" (2015)
+/// @param  removed     Set to the removed item, if any. The original node still
+///                     holds a reference to it.
+static struct EasyTableNode *
+remove_node(struct EasyTableNode *const me,
+            struct EasyGenericObject const *const key,
+            uint64_t const hash,
+            unsigned const shift,
+            struct EasyTableItem const **const removed)
+{
+    if (is_collision_level(shift)) {
+        for (size_t i = 0; i < me->num_items; ++i) {
+            if (is_matching_item(get_item(me, i), key, hash)) {
+                *removed = get_item(me, i);
+                if (me->num_items == 1) {
+                    return NULL;
+                }
+                return copy_node_with_gaps(me, i, -1, SIZE_MAX, 0);
+            }
         }
+        return retain_node(me);
     }
 
-    return new_table;
+    uint32_t const bit = hash_bit(hash, shift);
+    if (me->item_bitmap & bit) {
+        size_t const idx = bitmap_index(me->item_bitmap, bit);
+        if (!has_matching_tag(me, hash, shift) ||
+            !is_matching_item(get_item(me, idx), key, hash)) {
+            return retain_node(me);
+        }
+        *removed = get_item(me, idx);
+        struct EasyTableNode *node =
+            copy_node_with_gaps(me, idx, -1, SIZE_MAX, 0);
+        node->item_bitmap &= ~bit;
+        if (is_empty_node(node)) {
+            release_node(node);
+            return NULL;
+        }
+        return node;
+    } else if (me->node_bitmap & bit) {
+        size_t const node_idx = bitmap_index(me->node_bitmap, bit);
+        struct EasyTableNode *const old_child = get_child(me, node_idx);
+        struct EasyTableNode *const child =
+            remove_node(old_child,
+                        key,
+                        hash,
+                        shift + EASY_TABLE_BITS_PER_LEVEL,
+                        removed);
+        if (*removed == NULL) {
+            release_node(child);
+            return retain_node(me);
+        }
+        if (child == NULL) {
+            struct EasyTableNode *node =
+                copy_node_with_gaps(me, SIZE_MAX, 0, node_idx, -1);
+            node->node_bitmap &= ~bit;
+            if (is_empty_node(node)) {
+                release_node(node);
+                return NULL;
+            }
+            return node;
+        }
+        if (child->num_items == 1 && child->num_nodes == 0) {
+            /* Pull a lone item back up, so that the trie is no deeper than
+             * one that we built without the removed keys. */
+            struct EasyTableItem *const item = retain_item(get_item(child, 0));
+            release_node(child);
+            size_t const idx = bitmap_index(me->item_bitmap, bit);
+            struct EasyTableNode *node =
+                copy_node_with_gaps(me, idx, +1, node_idx, -1);
+            node->node_bitmap &= ~bit;
+            node->item_bitmap |= bit;
+            set_tag(node, item->hash, shift);
+            node->slots[idx].item = item;
+            return node;
+        }
+        struct EasyTableNode *node =
+            copy_node_with_gaps(me, SIZE_MAX, 0, SIZE_MAX, 0);
+        release_node(node->slots[node->num_items + node_idx].node);
+        node->slots[node->num_items + node_idx].node = child;
+        return node;
+    }
+    return retain_node(me);
+}
+
+static struct EasyTableItem const *
+lookup_item(struct EasyTableNode const *const root,
+            struct EasyGenericObject const *const key,
+            uint64_t const hash)
+{
+    struct EasyTableNode const *node = root;
+    unsigned shift = 0;
+    while (node != NULL) {
+        if (is_collision_level(shift)) {
+            for (size_t i = 0; i < node->num_items; ++i) {
+                if (is_matching_item(get_item(node, i), key, hash)) {
+                    return get_item(node, i);
+                }
+            }
+            return NULL;
+        }
+        uint32_t const bit = hash_bit(hash, shift);
+        if (node->item_bitmap & bit) {
+            if (!has_matching_tag(node, hash, shift)) {
+                return NULL;
+            }
+            struct EasyTableItem const *const item =
+                get_item(node, bitmap_index(node->item_bitmap, bit));
+            return is_matching_item(item, key, hash) ? item : NULL;
+        } else if (node->node_bitmap & bit) {
+            node = get_child(node, bitmap_index(node->node_bitmap, bit));
+            shift += EASY_TABLE_BITS_PER_LEVEL;
+        } else {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ *  TABLE
+ ******************************************************************************/
+
+struct EasyTable
+EasyTable__new_empty(void)
+{
+    struct EasyTable new_item = {
+        .root = NULL, .length = 0, .next_order = 0, .hash_sum = 0};
+    return new_item;
 }
 
 struct EasyTable
@@ -126,63 +504,46 @@ EasyTable__insert(struct EasyTable const *const me,
                   struct EasyGenericObject const *const key,
                   struct EasyGenericObject const *const value)
 {
-    EASY_GUARD(me != NULL, "pointer must not be NULL");
-    // me->capacity != 0 implies me->data != NULL ((not A) or B)
-    EASY_GUARD(!(me->capacity != 0) || me->data != NULL, "invalid capacity");
-    if (is_capacity_zero(me)) {
-        struct EasyTable new_item = new_empty_table_with_capacity(1);
-        new_item.data[0] =
-            (struct EasyTableItem){.valid = EASY_TABLE_VALID,
-                                   .hash = EasyGenericObject__hash(key),
-                                   .key = EasyGenericObject__copy(key),
-                                   .value = EasyGenericObject__copy(value)};
-        ++new_item.length;
-        return new_item;
+    EASY_GUARD(me != NULL && key != NULL && value != NULL,
+               "pointer must not be NULL");
+    uint64_t const hash = EasyGenericObject__hash(key);
+    struct EasyTableItem *const item =
+        new_item(hash, me->next_order, key, value);
+    if (me->root == NULL) {
+        struct EasyTableNode *root = new_node(1, 0);
+        root->item_bitmap = hash_bit(hash, 0);
+        set_tag(root, hash, 0);
+        root->slots[0].item = item;
+        return (struct EasyTable){.root = root,
+                                  .length = 1,
+                                  .next_order = me->next_order + 1,
+                                  .hash_sum = item->entry_hash};
     }
-    uint64_t hash = EasyGenericObject__hash(key);
-    struct IndexStatus const status = get_wouldbe_position(me, key, hash);
-    if (status.found) {
-        struct EasyTable new_item = EasyTable__copy(me);
-        EasyGenericObject__destroy(&new_item.data[status.idx].value);
-        new_item.data[status.idx].value = EasyGenericObject__copy(value);
-        return new_item;
-    } else if (is_enough_room(me)) {
-        struct EasyTable new_item = EasyTable__copy(me);
-        EASY_ASSERT(!status.found, "should not find key");
-        EASY_ASSERT(status.idx != me->capacity, "should be enough room");
-        new_item.data[status.idx] =
-            (struct EasyTableItem){.valid = EASY_TABLE_VALID,
-                                   .key = EasyGenericObject__copy(key),
-                                   .hash = hash,
-                                   .value = EasyGenericObject__copy(value)};
-        ++new_item.length;
-        return new_item;
-    } else {
-        struct EasyTable new_item = resize_table(me, 2 * me->capacity);
-        struct IndexStatus const status =
-            get_wouldbe_position(&new_item, key, hash);
-        EASY_ASSERT(!status.found, "should not find key");
-        new_item.data[status.idx] =
-            (struct EasyTableItem){.valid = EASY_TABLE_VALID,
-                                   .key = EasyGenericObject__copy(key),
-                                   .hash = hash,
-                                   .value = EasyGenericObject__copy(value)};
-        ++new_item.length;
-        return new_item;
+    struct EasyTableItem const *replaced = NULL;
+    struct EasyTableNode *const root =
+        insert_node(me->root, item, 0, &replaced);
+    /* The new nodes are not shared yet, so we may still modify the item */
+    if (replaced != NULL) {
+        item->order = replaced->order;
     }
+    /* Unsigned arithmetic wraps, so we can subtract the replaced entry */
+    return (struct EasyTable){
+        .root = root,
+        .length = me->length + (replaced != NULL ? 0 : 1),
+        .next_order = me->next_order + (replaced != NULL ? 0 : 1),
+        .hash_sum = me->hash_sum + item->entry_hash -
+                    (replaced != NULL ? replaced->entry_hash : 0)};
 }
 
 struct EasyGenericObject
 EasyTable__lookup(struct EasyTable const *const me,
                   struct EasyGenericObject const *const key)
 {
-    uint64_t hash = EasyGenericObject__hash(key);
-    struct IndexStatus s = get_wouldbe_position(me, key, hash);
-    if (s.found) {
-        size_t i = s.idx;
-        EASY_ASSERT(i < me->capacity, "must in range");
-        EASY_ASSERT(me->data[i].valid, "must be valid");
-        return EasyGenericObject__copy(&me->data[i].value);
+    EASY_GUARD(me != NULL && key != NULL, "pointer must not be NULL");
+    uint64_t const hash = EasyGenericObject__hash(key);
+    struct EasyTableItem const *const item = lookup_item(me->root, key, hash);
+    if (item != NULL) {
+        return EasyGenericObject__copy(&item->value);
     }
     // TODO What should we return if there is nothing there?
     return (struct EasyGenericObject){.type = EASY_NOTHING_TYPE,
@@ -193,98 +554,115 @@ struct EasyTable
 EasyTable__remove(struct EasyTable const *const me,
                   struct EasyGenericObject const *const key)
 {
-    uint64_t hash = EasyGenericObject__hash(key);
-    struct IndexStatus s = get_wouldbe_position(me, key, hash);
-    if (s.found) {
-        size_t i = s.idx;
-        EASY_ASSERT(i < me->capacity, "must in range");
-        EASY_ASSERT(me->data[i].valid, "must be valid");
-
-        // TODO Should we consider shrinking the array?
-        struct EasyTable new_me = EasyTable__copy(me);
-        EasyGenericObject__destroy(&new_me.data[i].key);
-        EasyGenericObject__destroy(&new_me.data[i].value);
-        new_me.data[i].valid = EASY_TABLE_TOMBSTONE;
-        new_me.data[i].hash = 0;
-        return new_me;
+    EASY_GUARD(me != NULL && key != NULL, "pointer must not be NULL");
+    if (me->root == NULL) {
+        return EasyTable__new_empty();
     }
-    return EasyTable__copy(me);
+    uint64_t const hash = EasyGenericObject__hash(key);
+    struct EasyTableItem const *removed = NULL;
+    struct EasyTableNode *const root =
+        remove_node(me->root, key, hash, 0, &removed);
+    return (struct EasyTable){
+        .root = root,
+        .length = me->length - (removed != NULL ? 1 : 0),
+        .next_order = me->next_order,
+        .hash_sum = me->hash_sum - (removed != NULL ? removed->entry_hash : 0)};
 }
 
 struct EasyTable
 EasyTable__copy(struct EasyTable const *const me)
 {
     EASY_GUARD(me != NULL, "pointer must not be NULL");
-    // me->capacity != 0 implies me->data != NULL ((not A) or B)
-    EASY_GUARD(!(me->capacity != 0) || me->data != NULL, "invalid capacity");
-    struct EasyTable new_item = {
-        .data = EASY_MALLOC(me->capacity, sizeof(*me->data)),
+    // me->length != 0 implies me->root != NULL ((not A) or B)
+    EASY_GUARD(!(me->length != 0) || me->root != NULL, "invalid length");
+    /* The nodes are immutable, so we share them rather than copy them */
+    return (struct EasyTable){
+        .root = me->root == NULL ? NULL : retain_node(me->root),
         .length = me->length,
-        .capacity = me->capacity};
-    for (size_t i = 0; i < me->capacity; ++i) {
-        if (me->data[i].valid == EASY_TABLE_VALID) {
-            new_item.data[i] = (struct EasyTableItem){
-                .valid = EASY_TABLE_VALID,
-                .hash = me->data[i].hash,
-                .key = EasyGenericObject__copy(&me->data[i].key),
-                .value = EasyGenericObject__copy(&me->data[i].value)};
-        } else {
-            new_item.data[i] =
-                (struct EasyTableItem){.valid = me->data[i].valid};
-        }
+        .next_order = me->next_order,
+        .hash_sum = me->hash_sum};
+}
+
+static void
+print_node_json(struct EasyTableNode const *const me)
+{
+    printf("{\"type\": \"EasyTableNode\", \".refcount\": %zu, "
+           "\".item_bitmap\": %" PRIu32 ", \".node_bitmap\": %" PRIu32
+           ", \".items\": [",
+           me->refcount,
+           me->item_bitmap,
+           me->node_bitmap);
+    for (size_t i = 0; i < me->num_items; ++i) {
+        struct EasyTableItem const *const item = get_item(me, i);
+        printf("{\".hash\": %" PRIu64 ", \".order\": %zu, \".key\": ",
+               item->hash,
+               item->order);
+        EasyGenericObject__print_json(&item->key);
+        printf(", \".value\": ");
+        EasyGenericObject__print_json(&item->value);
+        printf("}%s", i + 1 < me->num_items ? ", " : "");
     }
-    return new_item;
+    printf("], \".nodes\": [");
+    for (size_t i = 0; i < me->num_nodes; ++i) {
+        print_node_json(get_child(me, i));
+        printf("%s", i + 1 < me->num_nodes ? ", " : "");
+    }
+    printf("]}");
 }
 
 void
 EasyTable__print_json(struct EasyTable const *const me)
 {
     EASY_GUARD(me != NULL, "pointer must not be NULL");
-    // me->capacity != 0 implies me->data != NULL ((not A) or B)
-    EASY_GUARD(!(me->capacity != 0) || me->data != NULL, "invalid capacity");
-    printf("{\"type\": \"EasyTable\", \".length\": %zu, \".capacity\": %zu, "
-           "\".data\": [",
-           me->length,
-           me->capacity);
-    for (size_t i = 0; i < me->capacity; ++i) {
-        if (me->data[i].valid == EASY_TABLE_VALID) {
-            printf("{\".key\": ");
-            EasyGenericObject__print_json(&me->data[i].key);
-            printf(", \".value\": ");
-            EasyGenericObject__print(&me->data[i].value);
-            printf("}");
-        } else {
-            printf("null");
-        }
+    // me->length != 0 implies me->root != NULL ((not A) or B)
+    EASY_GUARD(!(me->length != 0) || me->root != NULL, "invalid length");
+    printf("{\"type\": \"EasyTable\", \".length\": %zu, \".root\": ",
+           me->length);
+    if (me->root == NULL) {
+        printf("null");
+    } else {
+        print_node_json(me->root);
+    }
+    printf("}");
+}
 
-        if (!is_last_element(i, me->capacity)) {
-            printf(", ");
-        }
+/// @brief  Append the items of a node (in trie order) to the array, returning
+///         the new number of items in it.
+static size_t
+collect_items(struct EasyTableNode const *const me,
+              struct EasyTableItem const **const items,
+              size_t num_items)
+{
+    for (size_t i = 0; i < me->num_items; ++i) {
+        items[num_items++] = get_item(me, i);
     }
-    printf("]}");
+    for (size_t i = 0; i < me->num_nodes; ++i) {
+        num_items = collect_items(get_child(me, i), items, num_items);
+    }
+    return num_items;
 }
 
 void
 EasyTable__print(struct EasyTable const *const me)
 {
     EASY_GUARD(me != NULL, "pointer must not be NULL");
-    // me->capacity != 0 implies me->data != NULL ((not A) or B)
-    EASY_GUARD(!(me->capacity != 0) || me->data != NULL, "invalid capacity");
+    // me->length != 0 implies me->root != NULL ((not A) or B)
+    EASY_GUARD(!(me->length != 0) || me->root != NULL, "invalid length");
 
     printf("{");
-    size_t seen_elements = 0;
-    for (size_t i = 0; i < me->capacity; ++i) {
-        if (me->data[i].valid == EASY_TABLE_VALID) {
-            EasyGenericObject__print(&me->data[i].key);
+    if (me->root != NULL) {
+        struct EasyTableItem const **items =
+            EASY_MALLOC(me->length, sizeof(*items));
+        size_t const num_items = collect_items(me->root, items, 0);
+        EASY_ASSERT(num_items == me->length, "length mismatch");
+        qsort(items, num_items, sizeof(*items), compare_item_order);
+        for (size_t i = 0; i < num_items; ++i) {
+            printf("%s", i != 0 ? ", " : "");
+            EasyGenericObject__print(&items[i]->key);
             printf(": ");
-            EasyGenericObject__print(&me->data[i].value);
-            ++seen_elements;
-            // We know there are no more elements to be seen!
-            if (seen_elements == me->length) {
-                break;
-            }
-            printf(", ");
+            EasyGenericObject__print(&items[i]->value);
         }
+        EASY_FREE(items);
     }
     printf("}");
 }
@@ -292,16 +670,174 @@ EasyTable__print(struct EasyTable const *const me)
 void
 EasyTable__destroy(struct EasyTable *const me)
 {
-    // NOTE   This excludes destroying empty tables.
     EASY_GUARD(me != NULL, "ptr must not be NULL");
-    // me->capacity != 0 implies me->data != NULL ((not A) or B)
-    EASY_GUARD(!(me->capacity != 0) || me->data != NULL, "invalid capacity");
-    for (size_t i = 0; i < me->capacity; ++i) {
-        if (me->data[i].valid == EASY_TABLE_VALID) {
-            EasyGenericObject__destroy(&me->data[i].key);
-            EasyGenericObject__destroy(&me->data[i].value);
-        }
+    // me->length != 0 implies me->root != NULL ((not A) or B)
+    EASY_GUARD(!(me->length != 0) || me->root != NULL, "invalid length");
+    if (me->root != NULL) {
+        release_node(me->root);
     }
-    free(me->data);
     *me = (struct EasyTable){0};
 }
+
+/*******************************************************************************
+ *  TABLE BUILDER
+ ******************************************************************************/
+
+/// @brief  Open a gap for one slot at the given position, growing the node if
+///         it is full. We return the (possibly moved) node.
+/// @note   The builder must own the node exclusively.
+static struct EasyTableNode *
+insert_slot_in_place(struct EasyTableNode *node, size_t const pos)
+{
+    EASY_ASSERT(node->refcount == 1, "the builder must own the node");
+    size_t const num_slots = node->num_items + node->num_nodes;
+    EASY_ASSERT(pos <= num_slots, "position out of range");
+    if (num_slots == node->capacity) {
+        size_t const capacity =
+            num_slots < EASY_TABLE_BRANCHING
+                ? MIN(MAX(2 * num_slots, (size_t)1),
+                      (size_t)EASY_TABLE_BRANCHING)
+                : 2 * num_slots;
+        node = EASY_REALLOC(node,
+                            1,
+                            sizeof(struct EasyTableNode) +
+                                capacity * sizeof(node->slots[0]));
+        node->capacity = capacity;
+    }
+    memmove(&node->slots[pos + 1],
+            &node->slots[pos],
+            (num_slots - pos) * sizeof(node->slots[0]));
+    return node;
+}
+
+/// @brief  Insert the item into a node that the builder owns, taking ownership
+///         of the item. We return the (possibly moved) node.
+/// @param  replaced    Set to the item we replaced, if any. We hand the
+///                     builder's reference to it back to the caller.
+static struct EasyTableNode *
+insert_node_in_place(struct EasyTableNode *node,
+                     struct EasyTableItem *const item,
+                     unsigned const shift,
+                     struct EasyTableItem **const replaced)
+{
+    EASY_ASSERT(node->refcount == 1, "the builder must own the node");
+    if (is_collision_level(shift)) {
+        for (size_t i = 0; i < node->num_items; ++i) {
+            if (is_matching_item(get_item(node, i), &item->key, item->hash)) {
+                *replaced = node->slots[i].item;
+                node->slots[i].item = item;
+                return node;
+            }
+        }
+        node = insert_slot_in_place(node, node->num_items);
+        node->slots[node->num_items++].item = item;
+        return node;
+    }
+
+    uint32_t const bit = hash_bit(item->hash, shift);
+    if (node->item_bitmap & bit) {
+        size_t const idx = bitmap_index(node->item_bitmap, bit);
+        struct EasyTableItem *const old_item = get_item(node, idx);
+        if (has_matching_tag(node, item->hash, shift) &&
+            is_matching_item(old_item, &item->key, item->hash)) {
+            node->slots[idx].item = item;
+            *replaced = old_item;
+            return node;
+        }
+        /* Push both items down into a new subtrie. This moves a slot from the
+         * items to the nodes, so the node never needs to grow. */
+        size_t const num_slots = node->num_items + node->num_nodes;
+        memmove(&node->slots[idx],
+                &node->slots[idx + 1],
+                (num_slots - idx - 1) * sizeof(node->slots[0]));
+        --node->num_items;
+        node->item_bitmap &= ~bit;
+        size_t const pos =
+            node->num_items + bitmap_index(node->node_bitmap, bit);
+        node = insert_slot_in_place(node, pos);
+        node->slots[pos].node =
+            merge_items(old_item, item, shift + EASY_TABLE_BITS_PER_LEVEL);
+        ++node->num_nodes;
+        node->node_bitmap |= bit;
+        return node;
+    } else if (node->node_bitmap & bit) {
+        size_t const pos =
+            node->num_items + bitmap_index(node->node_bitmap, bit);
+        node->slots[pos].node =
+            insert_node_in_place(node->slots[pos].node,
+                                 item,
+                                 shift + EASY_TABLE_BITS_PER_LEVEL,
+                                 replaced);
+        return node;
+    } else {
+        size_t const idx = bitmap_index(node->item_bitmap, bit);
+        node = insert_slot_in_place(node, idx);
+        node->slots[idx].item = item;
+        ++node->num_items;
+        node->item_bitmap |= bit;
+        set_tag(node, item->hash, shift);
+        return node;
+    }
+}
+
+struct EasyTableBuilder
+EasyTableBuilder__new_empty(void)
+{
+    return (struct EasyTableBuilder){
+        .root = NULL, .length = 0, .next_order = 0, .hash_sum = 0};
+}
+
+void
+EasyTableBuilder__insert(struct EasyTableBuilder *const me,
+                         struct EasyGenericObject const *const key,
+                         struct EasyGenericObject const *const value)
+{
+    EASY_GUARD(me != NULL && key != NULL && value != NULL,
+               "pointer must not be NULL");
+    uint64_t const hash = EasyGenericObject__hash(key);
+    struct EasyTableItem *const item =
+        new_item(hash, me->next_order, key, value);
+    if (me->root == NULL) {
+        me->root = new_node(1, 0);
+        me->root->item_bitmap = hash_bit(hash, 0);
+        set_tag(me->root, hash, 0);
+        me->root->slots[0].item = item;
+        me->length = 1;
+        ++me->next_order;
+        me->hash_sum = item->entry_hash;
+        return;
+    }
+    struct EasyTableItem *replaced = NULL;
+    me->root = insert_node_in_place(me->root, item, 0, &replaced);
+    me->hash_sum += item->entry_hash;
+    if (replaced != NULL) {
+        item->order = replaced->order;
+        me->hash_sum -= replaced->entry_hash;
+        release_item(replaced);
+    } else {
+        ++me->length;
+        ++me->next_order;
+    }
+}
+
+struct EasyTable
+EasyTableBuilder__freeze(struct EasyTableBuilder *const me)
+{
+    EASY_GUARD(me != NULL, "pointer must not be NULL");
+    struct EasyTable table = {.root = me->root,
+                              .length = me->length,
+                              .next_order = me->next_order,
+                              .hash_sum = me->hash_sum};
+    *me = EasyTableBuilder__new_empty();
+    return table;
+}
+
+void
+EasyTableBuilder__destroy(struct EasyTableBuilder *const me)
+{
+    EASY_GUARD(me != NULL, "pointer must not be NULL");
+    if (me->root != NULL) {
+        release_node(me->root);
+    }
+    *me = EasyTableBuilder__new_empty();
+}
@@ -2,15 +2,28 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 struct EasyGenericObject;
-struct EasyTableItem;
+struct EasyTableNode;
 
-/* EasyTable */
+/* EasyTable
+ * This is a persistent hash array mapped trie. A "modification" returns a new
+ * table that shares every untouched node with the original, so inserting,
+ * looking up, and removing a key are all O(log32 n).
+ *
+ * We print the items in the order that their keys were first inserted (like
+ * Python's dict), so the output does not depend on the hash seed. Replacing a
+ * key's value keeps its place; removing and reinserting it moves it to the
+ * end. */
 struct EasyTable {
-    struct EasyTableItem *data;
-    size_t length;   /* The number of elements in the EasyTable */
-    size_t capacity; /* The maximum number of elements in the EasyTable */
+    struct EasyTableNode *root; /* NULL if the EasyTable is empty */
+    size_t length;              /* The number of elements in the EasyTable */
+    size_t next_order;          /* The insertion order of the next new key */
+    /* The sum of the items' entry hashes. Addition is commutative, so this
+     * does not depend on the order of the items, and we update it in O(1)
+     * whenever we insert or remove an item. */
+    uint64_t hash_sum;
 };
 
 struct EasyTable
@@ -34,3 +47,26 @@ void
 EasyTable__print_json(struct EasyTable const *const me);
 void
 EasyTable__print(struct EasyTable const *const me);
+
+/* EasyTableBuilder
+ * This is explicitly Mutable. It builds a table in place, one item at a time,
+ * without creating an intermediate version per insertion. Freezing it hands
+ * the trie over to a regular EasyTable in O(1) and leaves the builder empty.
+ */
+struct EasyTableBuilder {
+    struct EasyTableNode *root; /* Every node is owned solely by the builder */
+    size_t length;
+    size_t next_order;
+    uint64_t hash_sum;
+};
+
+struct EasyTableBuilder
+EasyTableBuilder__new_empty(void);
+void
+EasyTableBuilder__insert(struct EasyTableBuilder *const me,
+                         struct EasyGenericObject const *const key,
+                         struct EasyGenericObject const *const value);
+struct EasyTable
+EasyTableBuilder__freeze(struct EasyTableBuilder *const me);
+void
+EasyTableBuilder__destroy(struct EasyTableBuilder *const me);
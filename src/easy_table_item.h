@@ -1,26 +1,54 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "easy_lib.h"
 
-enum EasyTableItemStatus {
-    /* This is intentionally zero because using calloc to allocate the array
-     * will create all INVALID entries. */
-    EASY_TABLE_INVALID = 0,
-    /* A tombstone is where an entry was formerly found but was removed in
-     * a hash table with simple linear probing. This tells future searches
-     * that the element they are looking for may have been pushed farther
-     * away by the now-removed element (i.e. keep looking). An insert can
-     * stick its element into a tombstone. */
-    EASY_TABLE_TOMBSTONE,
-    EASY_TABLE_VALID,
-};
+/* The EasyTable is a persistent hash array mapped trie (HAMT). Each level of
+ * the trie consumes EASY_TABLE_BITS_PER_LEVEL bits of the key's hash. Once we
+ * have run out of hash bits, the keys genuinely collide and we store them in a
+ * flat "collision node" that we search linearly. */
+#define EASY_TABLE_BITS_PER_LEVEL 5
+#define EASY_TABLE_BRANCHING      (1 << EASY_TABLE_BITS_PER_LEVEL)
+#define EASY_TABLE_LEVEL_MASK     (EASY_TABLE_BRANCHING - 1)
+#define EASY_TABLE_HASH_BITS      64
+#define EASY_TABLE_TAG_BITS       8
 
 /* NOTE These need to come after the EasyGenericObject */
+/* Items are immutable once created. We share them between every version of
+ * the table that contains them, so we count the number of references. */
 struct EasyTableItem {
-    enum EasyTableItemStatus valid;
-    uint64_t hash;
+    size_t refcount;
+    uint64_t hash;       /* The key's hash */
+    uint64_t entry_hash; /* The key's hash mixed with the value's */
+    size_t order;        /* When the key was first inserted into the table */
     struct EasyGenericObject key;
     struct EasyGenericObject value;
 };
+
+union EasyTableSlot {
+    struct EasyTableItem *item;
+    struct EasyTableNode *node;
+};
+
+/* Nodes are immutable once they are reachable from a table. Inserting or
+ * removing a key copies the path from the root to the key (i.e. O(log32 n)
+ * nodes) and shares every other node with the original table. */
+struct EasyTableNode {
+    size_t refcount;
+    /* Bit i is set if the i-th hash fragment holds an item (or a child node,
+     * respectively). These are unused in a collision node. */
+    uint32_t item_bitmap;
+    uint32_t node_bitmap;
+    /* The top byte of each item's hash, indexed by the hash fragment. We check
+     * these before we load an item, so a lookup that misses rarely touches
+     * anything but the nodes on its path. These are unused in a collision
+     * node, where every item has the same hash. */
+    uint8_t tags[EASY_TABLE_BRANCHING];
+    size_t num_items;
+    size_t num_nodes;
+    size_t capacity; /* The number of slots allocated */
+    /* The items come first (in bitmap order), followed by the child nodes. */
+    union EasyTableSlot slots[];
+};
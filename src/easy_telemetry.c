@@ -0,0 +1,286 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "easy_common.h"
+#include "easy_text.h"
+
+#include "easy_telemetry.h"
+
+/* There are a few dozen callsites in the library, so this is plenty. The
+ * capacity is a power of two so that we can mask the hash. */
+#define EASY_TELEMETRY_MAX_CALLSITES 1024
+/* Bucket i of the histogram counts the sizes in [2^(i-1), 2^i), so bucket 0
+ * counts the empty allocations and the last bucket counts the rest. */
+#define EASY_TELEMETRY_NUM_BUCKETS 32
+
+struct EasyTelemetryCallsite {
+    char const *file; /* NULL if the slot is empty */
+    int line;
+    struct EasyTelemetryStats stats;
+    size_t histogram[EASY_TELEMETRY_NUM_BUCKETS];
+};
+
+static struct EasyTelemetryCallsite callsites[EASY_TELEMETRY_MAX_CALLSITES];
+static size_t num_callsites = 0;
+static struct EasyTelemetryStats totals = {0};
+static bool is_registered = false;
+/* Every thread records into the same counters, so we update them under a
+ * lock. We note when this thread holds it, since a failed assertion may exit
+ * (and so print the counters) from within an update. */
+static pthread_mutex_t telemetry_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread bool is_locked = false;
+
+static void
+lock_telemetry(void)
+{
+    EASY_ASSERT(pthread_mutex_lock(&telemetry_lock) == 0, "cannot lock");
+    is_locked = true;
+}
+
+static void
+unlock_telemetry(void)
+{
+    is_locked = false;
+    EASY_ASSERT(pthread_mutex_unlock(&telemetry_lock) == 0, "cannot unlock");
+}
+
+static size_t
+hash_callsite(char const *const file, int const line)
+{
+    /* FNV-1a */
+    size_t hash = 14695981039346656037ULL & SIZE_MAX;
+    for (char const *c = file; *c != '\0'; ++c) {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    }
+    return (hash ^ (size_t)line) * 1099511628211ULL;
+}
+
+static size_t
+get_bucket(size_t num_bytes)
+{
+    size_t bucket = 0;
+    while (num_bytes != 0 && bucket + 1 < EASY_TELEMETRY_NUM_BUCKETS) {
+        num_bytes >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+static size_t
+find_callsite(char const *const file, int const line)
+{
+    size_t const mask = EASY_TELEMETRY_MAX_CALLSITES - 1;
+    for (size_t i = hash_callsite(file, line) & mask;; i = (i + 1) & mask) {
+        struct EasyTelemetryCallsite *const callsite = &callsites[i];
+        if (callsite->file == NULL) {
+            EASY_ASSERT(num_callsites + 1 < EASY_TELEMETRY_MAX_CALLSITES,
+                        "too many callsites");
+            callsite->file = file;
+            callsite->line = line;
+            ++num_callsites;
+            return i;
+        }
+        if (callsite->line == line &&
+            (callsite->file == file || strcmp(callsite->file, file) == 0)) {
+            return i;
+        }
+    }
+}
+
+static void
+add_alloc(struct EasyTelemetryStats *const stats, size_t const num_bytes)
+{
+    ++stats->num_allocs;
+    stats->num_bytes += num_bytes;
+    ++stats->live_allocs;
+    stats->live_bytes += num_bytes;
+    stats->peak_live_bytes = MAX(stats->peak_live_bytes, stats->live_bytes);
+}
+
+static void
+add_free(struct EasyTelemetryStats *const stats, size_t const num_bytes)
+{
+    EASY_ASSERT(stats->live_allocs > 0 && stats->live_bytes >= num_bytes,
+                "freeing more than we allocated");
+    ++stats->num_frees;
+    --stats->live_allocs;
+    stats->live_bytes -= num_bytes;
+}
+
+static void
+print_json(FILE *const stream);
+
+static void
+print_at_exit(void)
+{
+    char const *const path = getenv("EASY_MEMORY_TELEMETRY_PATH");
+    FILE *const stream = path != NULL ? fopen(path, "w") : stderr;
+    if (stream == NULL) {
+        easy_print_error("cannot open the telemetry file", __FILE__, __LINE__);
+        return;
+    }
+    /* If we are exiting from within an update, then we already hold the lock
+     * and print the counters as they stand. */
+    bool const was_locked = is_locked;
+    if (!was_locked) {
+        lock_telemetry();
+    }
+    print_json(stream);
+    if (!was_locked) {
+        unlock_telemetry();
+    }
+    fprintf(stream, "\n");
+    if (stream != stderr) {
+        fclose(stream);
+    }
+}
+
+bool
+EasyTelemetry__is_enabled(void)
+{
+#ifdef EASY_MEMORY_TELEMETRY
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t
+EasyTelemetry__record_alloc(char const *const file,
+                            int const line,
+                            size_t const num_bytes)
+{
+    lock_telemetry();
+    if (!is_registered) {
+        EASY_ASSERT(atexit(print_at_exit) == 0, "cannot register atexit");
+        is_registered = true;
+    }
+    size_t const i = find_callsite(file, line);
+    add_alloc(&totals, num_bytes);
+    add_alloc(&callsites[i].stats, num_bytes);
+    ++callsites[i].histogram[get_bucket(num_bytes)];
+    unlock_telemetry();
+    return i;
+}
+
+void
+EasyTelemetry__record_free(size_t const callsite, size_t const num_bytes)
+{
+    lock_telemetry();
+    EASY_GUARD(callsite < EASY_TELEMETRY_MAX_CALLSITES &&
+                   callsites[callsite].file != NULL,
+               "invalid callsite");
+    add_free(&totals, num_bytes);
+    add_free(&callsites[callsite].stats, num_bytes);
+    unlock_telemetry();
+}
+
+struct EasyTelemetryStats
+EasyTelemetry__get_stats(void)
+{
+    lock_telemetry();
+    struct EasyTelemetryStats const stats = totals;
+    unlock_telemetry();
+    return stats;
+}
+
+/// @brief  Order the callsites by live bytes and then by total bytes, both
+///         descending.
+static int
+compare_callsites(void const *const lhs, void const *const rhs)
+{
+    struct EasyTelemetryStats const *const a =
+        &(*(struct EasyTelemetryCallsite const *const *)lhs)->stats;
+    struct EasyTelemetryStats const *const b =
+        &(*(struct EasyTelemetryCallsite const *const *)rhs)->stats;
+    if (a->live_bytes != b->live_bytes) {
+        return a->live_bytes < b->live_bytes ? 1 : -1;
+    }
+    if (a->num_bytes != b->num_bytes) {
+        return a->num_bytes < b->num_bytes ? 1 : -1;
+    }
+    return 0;
+}
+
+static void
+print_stats_json(FILE *const stream,
+                 struct EasyTelemetryStats const *const stats)
+{
+    fprintf(stream,
+            "\"num_allocs\": %zu, \"num_frees\": %zu, \"num_bytes\": %zu, "
+            "\"live_allocs\": %zu, \"live_bytes\": %zu, "
+            "\"peak_live_bytes\": %zu",
+            stats->num_allocs,
+            stats->num_frees,
+            stats->num_bytes,
+            stats->live_allocs,
+            stats->live_bytes,
+            stats->peak_live_bytes);
+}
+
+static void
+print_callsite_json(FILE *const stream,
+                    struct EasyTelemetryCallsite const *const callsite)
+{
+    /* The file comes from __FILE__, so it may hold quotes or backslashes */
+    fprintf(stream, "{\"file\": \"");
+    EasyText__fprint_jsonified_cstr(stream, callsite->file);
+    fprintf(stream, "\", \"line\": %d, ", callsite->line);
+    print_stats_json(stream, &callsite->stats);
+    /* Each key is the exclusive upper bound of the bucket's sizes */
+    fprintf(stream, ", \"histogram\": {");
+    bool is_first = true;
+    for (size_t i = 0; i < EASY_TELEMETRY_NUM_BUCKETS; ++i) {
+        if (callsite->histogram[i] == 0) {
+            continue;
+        }
+        fprintf(stream,
+                "%s\"%zu\": %zu",
+                is_first ? "" : ", ",
+                (size_t)1 << i,
+                callsite->histogram[i]);
+        is_first = false;
+    }
+    fprintf(stream, "}}");
+}
+
+/// @brief  Print the counters. We must hold the lock.
+static void
+print_json(FILE *const stream)
+{
+    struct EasyTelemetryCallsite const **sorted =
+        calloc(MAX(num_callsites, 1), sizeof(*sorted));
+    EASY_ASSERT(sorted != NULL, "out of memory");
+    for (size_t i = 0, j = 0; i < EASY_TELEMETRY_MAX_CALLSITES; ++i) {
+        if (callsites[i].file != NULL) {
+            sorted[j++] = &callsites[i];
+        }
+    }
+    qsort(sorted, num_callsites, sizeof(*sorted), compare_callsites);
+
+    fprintf(stream,
+            "{\"type\": \"EasyTelemetry\", \"enabled\": %s, ",
+            EasyTelemetry__is_enabled() ? "true" : "false");
+    print_stats_json(stream, &totals);
+    fprintf(stream, ", \"callsites\": [");
+    for (size_t i = 0; i < num_callsites; ++i) {
+        fprintf(stream, "%s", i == 0 ? "" : ", ");
+        print_callsite_json(stream, sorted[i]);
+    }
+    fprintf(stream, "]}");
+    free(sorted);
+}
+
+void
+EasyTelemetry__print_json(FILE *const stream)
+{
+    EASY_GUARD(stream != NULL, "stream must not be NULL");
+    lock_telemetry();
+    print_json(stream);
+    unlock_telemetry();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* EasyTelemetry
+ * Account for the memory that EASY_MALLOC, EASY_CALLOC, EASY_REALLOC and
+ * EASY_SHARED_ALLOC hand out, so that we can find the operations that copy
+ * more than they should. We only record anything when we build with
+ * -DEASY_MEMORY_TELEMETRY (e.g. `make telemetry`). We then dump the counters
+ * as JSON to stderr when the program exits (or to the file that the
+ * EASY_MEMORY_TELEMETRY_PATH environment variable names).
+ *
+ * We attribute each allocation to the file and line that requested it. A
+ * reallocation frees the old memory at its original callsite and allocates
+ * the new memory at the reallocation's callsite, so a callsite's bytes count
+ * every byte that it has (re)allocated.
+ *
+ * NOTE Objects that die with their arena (rather than being destroyed) still
+ *      count as live, since we never see them freed.
+ * NOTE The counters are global, so every thread records into the same ones.
+ *      We update them under a lock.
+ */
+
+struct EasyTelemetryStats {
+    size_t num_allocs;
+    size_t num_frees;
+    size_t num_bytes; /* The number of bytes that we have allocated in total */
+    size_t live_allocs;
+    size_t live_bytes;
+    size_t peak_live_bytes;
+};
+
+/// @brief  Check whether we built with -DEASY_MEMORY_TELEMETRY.
+bool
+EasyTelemetry__is_enabled(void);
+/// @brief  Record an allocation and return the ID of its callsite, which we
+///         must pass back when we free it.
+size_t
+EasyTelemetry__record_alloc(char const *const file,
+                            int const line,
+                            size_t const num_bytes);
+void
+EasyTelemetry__record_free(size_t const callsite, size_t const num_bytes);
+struct EasyTelemetryStats
+EasyTelemetry__get_stats(void);
+/// @brief  Print the totals and the per-callsite counters (with a histogram of
+///         the allocation sizes), listing the callsites with the most live
+///         bytes first.
+void
+EasyTelemetry__print_json(FILE *const stream);
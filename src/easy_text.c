@@ -1,57 +1,73 @@
 #include <ctype.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "easy_arena.h"
 #include "easy_common.h"
+#include "easy_hash.h"
 
 #include "easy_text.h"
 
+/* The intern pool is an open-addressed set of texts, which we probe linearly.
+ * An empty slot has a zero length. We never remove a single text, so we need
+ * no tombstones. The capacity is a power of two (or zero). */
+#define EASY_TEXT_INTERN_MIN_CAPACITY 64
+
+struct EasyTextInternPool {
+    struct EasyText *texts;
+    size_t length;
+    size_t capacity;
+};
+
+static struct EasyTextInternPool intern_pool = {0};
+
 static void
 assert_well_formed(struct EasyText const *const me)
 {
     EASY_GUARD(me != NULL, "expected non-NULL me");
-    EASY_ASSERT(me->data[me->length] == '\0',
+    EASY_ASSERT(EasyText__get_data(me)[me->length] == '\0',
                 "expected '\0' terminated C-style string");
 }
 
 static inline void
-print_jsonified_char(char const c)
+print_jsonified_char(FILE *const stream, char const c)
 {
     // Escape special JSON characters according to
     // https://www.json.org/json-en.html
     switch (c) {
     case '\"':
-        printf("\"");
+        fprintf(stream, "\\\"");
         return;
     case '\\':
-        printf("\\");
+        fprintf(stream, "\\\\");
         return;
     /* NOTE: I do not escape '/', because it's already valid. The parser
      *      would need to be able to parse "\/", however. */
     /* NOTE: The bell '\a' is represented in hexadecimal in JSON. */
     case '\b': /* BACKSPACE */
-        printf("\\b");
+        fprintf(stream, "\\b");
         return;
     case '\f': /* FORM FEED */
-        printf("\\f");
+        fprintf(stream, "\\f");
         return;
     case '\n': /* NEW LINE */
-        printf("\\n");
+        fprintf(stream, "\\n");
         return;
     case '\r': /* CARRIAGE RETURN */
-        printf("\\r");
+        fprintf(stream, "\\r");
         return;
     case '\t': /* HORIZONTAL TAB */
-        printf("\\t");
+        fprintf(stream, "\\t");
         return;
     /* NOTE: The vertical tab '\v' is represented in hexadecimal in JSON. */
     default:
         if (isprint(c)) {
-            // NOTE I could also use `putchar(c)`, but this is less "easy".
-            printf("%c", c);
+            // NOTE I could also use `putc(c, stream)`, but this is less "easy".
+            fprintf(stream, "%c", c);
             return;
         } else {
-            printf("\\u%.4hhx", c);
+            fprintf(stream, "\\u%.4hhx", c);
             return;
         }
     }
@@ -64,15 +80,139 @@ EasyText__from_cstr(char const *const str)
 
     struct EasyText me = {0};
     me.length = strlen(str);
-    me.data = EASY_DUPLICATE(str, me.length + 1, sizeof(char));
+    if (me.length <= EASY_TEXT_SMALL_CAPACITY) {
+        memcpy(me.small, str, me.length + 1);
+        return me;
+    }
+    me.data = EASY_SHARED_ALLOC(me.length + 1, sizeof(char));
+    memcpy(me.data, str, me.length + 1);
+    return me;
+}
+
+char const *
+EasyText__get_data(struct EasyText const *const me)
+{
+    EASY_GUARD(me != NULL, "expected non-NULL me");
+    return me->data != NULL ? me->data : me->small;
+}
+
+static uint64_t
+hash_cstr(char const *const str, size_t const length)
+{
+    /* This must match EasyText__hash, so we hash the length first */
+    struct EasyHashState state = EasyHashState__new(EasyHash__seed());
+    EasyHashState__update(&state, &length, sizeof(length));
+    EasyHashState__update(&state, str, length);
+    return EasyHashState__digest(&state);
+}
+
+/// @brief  Build a text in a shared buffer (even if it is small), so that the
+///         copies of an interned text share it.
+static struct EasyText
+new_shared_text(char const *const str, size_t const length, uint64_t hash)
+{
+    struct EasyText me = {0};
+    me.length = length;
+    me.hash = hash;
+    me.data = EASY_SHARED_ALLOC(length + 1, sizeof(char));
+    memcpy(me.data, str, length);
     return me;
 }
 
+static struct EasyText *
+find_interned(struct EasyText *const texts,
+              size_t const capacity,
+              char const *const str,
+              size_t const length,
+              uint64_t const hash)
+{
+    size_t const mask = capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        struct EasyText *const text = &texts[i];
+        if (text->length == 0 ||
+            (text->hash == hash && text->length == length &&
+             memcmp(text->data, str, length) == 0)) {
+            return text;
+        }
+    }
+}
+
+static void
+grow_intern_pool(void)
+{
+    size_t const capacity =
+        MAX(2 * intern_pool.capacity, EASY_TEXT_INTERN_MIN_CAPACITY);
+    struct EasyText *const texts = EASY_CALLOC(capacity, sizeof(*texts));
+    for (size_t i = 0; i < intern_pool.capacity; ++i) {
+        struct EasyText const *const text = &intern_pool.texts[i];
+        if (text->length != 0) {
+            *find_interned(texts,
+                           capacity,
+                           text->data,
+                           text->length,
+                           text->hash) = *text;
+        }
+    }
+    if (intern_pool.texts != NULL) {
+        EASY_FREE(intern_pool.texts);
+    }
+    intern_pool.texts = texts;
+    intern_pool.capacity = capacity;
+}
+
+struct EasyText
+EasyText__intern(char const *const str)
+{
+    EASY_GUARD(str != NULL, "expected non-NULL C-style string");
+    size_t const length = strlen(str);
+    if (length == 0) {
+        /* The empty text is small and marks the pool's empty slots */
+        return EasyText__from_cstr(str);
+    }
+    /* The pool outlives any arena, so it must not allocate from one */
+    struct EasyArena *const previous = EasyArena__enter(NULL);
+    if (2 * (intern_pool.length + 1) > intern_pool.capacity) {
+        grow_intern_pool();
+    }
+    uint64_t const hash = hash_cstr(str, length);
+    struct EasyText *const text = find_interned(
+        intern_pool.texts, intern_pool.capacity, str, length, hash);
+    if (text->length == 0) {
+        *text = new_shared_text(str, length, hash);
+        ++intern_pool.length;
+    }
+    EasyArena__exit(previous);
+    return EasyText__copy(text);
+}
+
+void
+EasyText__clear_interned(void)
+{
+    for (size_t i = 0; i < intern_pool.capacity; ++i) {
+        if (intern_pool.texts[i].length != 0) {
+            EasyText__destroy(&intern_pool.texts[i]);
+        }
+    }
+    if (intern_pool.texts != NULL) {
+        EASY_FREE(intern_pool.texts);
+    }
+    intern_pool = (struct EasyTextInternPool){0};
+}
+
 void
 EasyText__print(struct EasyText const *const me)
 {
     assert_well_formed(me);
-    printf("%s", me->data);
+    printf("%s", EasyText__get_data(me));
+}
+
+void
+EasyText__fprint_jsonified_cstr(FILE *const stream, char const *const str)
+{
+    EASY_GUARD(stream != NULL && str != NULL, "inputs must be non-NULL");
+    for (char const *c = str; *c != '\0'; ++c) {
+        print_jsonified_char(stream, *c);
+    }
 }
 
 void
@@ -82,8 +222,9 @@ EasyText__print_json(struct EasyText const *const me)
     printf("{\"type\": \"EasyText\", \".data\": \"");
 
     /* Print JSON-ified characters */
+    char const *const data = EasyText__get_data(me);
     for (size_t i = 0; i < me->length; ++i) {
-        print_jsonified_char(me->data[i]);
+        print_jsonified_char(stdout, data[i]);
     }
 
     printf("\", \".length\": %zu}", me->length);
@@ -92,17 +233,27 @@ EasyText__print_json(struct EasyText const *const me)
 struct EasyText
 EasyText__copy(struct EasyText const *const me)
 {
-    EASY_GUARD(me != NULL && me->data != NULL, "ptr must not be NULL");
-    return (struct EasyText){
-        .data = EASY_DUPLICATE(&me->data, me->length, sizeof(*me->data)),
-        .length = me->length};
+    assert_well_formed(me);
+    /* A small text copies by value. Otherwise, the text is immutable, so we
+     * share the buffer. */
+    struct EasyText copy = {
+        .data = me->data,
+        .length = me->length,
+        .hash = __atomic_load_n(&me->hash, __ATOMIC_RELAXED)};
+    memcpy(copy.small, me->small, sizeof(copy.small));
+    if (copy.data != NULL) {
+        copy.data = EASY_SHARED_RETAIN(copy.data);
+    }
+    return copy;
 }
 
 void
 EasyText__destroy(struct EasyText *const me)
 {
-    EASY_GUARD(me != NULL && me->data != NULL, "input should be non-null");
-    EASY_FREE(me->data);
+    EASY_GUARD(me != NULL, "input should be non-null");
+    if (me->data != NULL && EASY_SHARED_RELEASE(me->data)) {
+        EASY_SHARED_FREE(me->data);
+    }
 
     EASY_SET_ZERO(me);
 }
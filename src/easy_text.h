@@ -2,18 +2,46 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Most texts are short identifiers, so we store texts of up to this many
+ * bytes inline rather than in a shared buffer. This keeps the text within the
+ * size of the largest member of EasyGenericData. */
+#define EASY_TEXT_SMALL_CAPACITY 23
 
 struct EasyText {
+    /* The shared buffer, or NULL if the text is small */
     char *data;
     size_t length; /* Not including the NIL byte at the end */
+    uint64_t hash; /* The memoised hash (zero until we first compute it) */
+    char small[EASY_TEXT_SMALL_CAPACITY + 1]; /* The text, if it is small */
 };
 
 struct EasyText
 EasyText__from_cstr(char const *const str);
+/// @brief  Get the canonical instance of a text from the intern pool, adding
+///         it if it is new. Every interned copy of a text shares one buffer
+///         (even if the text is short) and carries its hash, so comparing
+///         interned texts is a pointer comparison.
+/// @note   The pool is global and unsynchronized. It holds a reference to
+///         each text until we clear it, but clearing it leaves the interned
+///         copies that we still hold intact.
+struct EasyText
+EasyText__intern(char const *const str);
+void
+EasyText__clear_interned(void);
+/// @brief  Get the NIL-terminated characters, wherever we store them.
+char const *
+EasyText__get_data(struct EasyText const *const me);
 void
 EasyText__print(struct EasyText const *const me);
 void
 EasyText__print_json(struct EasyText const *const me);
+/// @brief  Write a C-style string's characters to a stream, escaped to go
+///         between the quotes of a JSON string.
+void
+EasyText__fprint_jsonified_cstr(FILE *const stream, char const *const str);
 struct EasyText
 EasyText__copy(struct EasyText const *const me);
 void
@@ -1,18 +1,26 @@
 /** Test file */
 
+#include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "common/easy_logger.h"
 #include "common/easy_test.h"
+#include "easy_arena.h"
 #include "easy_boolean.h"
+#include "easy_common.h"
 #include "easy_equal.h"
 #include "easy_error.h"
 #include "easy_hash.h"
 #include "easy_integer.h"
 #include "easy_lib.h"
 #include "easy_list.h"
+#include "easy_pool.h"
 #include "easy_table.h"
+#include "easy_table_item.h"
+#include "easy_telemetry.h"
 #include "easy_text.h"
 
 void
@@ -116,6 +124,304 @@ test_easy_integer(void)
     return true;
 }
 
+static bool
+is_same_integer(struct EasyInteger const *const a,
+                struct EasyInteger const *const b)
+{
+    /* The objects borrow the integers, so we must not destroy them */
+    struct EasyGenericObject const a_ = {.type = EASY_INTEGER_TYPE,
+                                         .data = {.integer = *a}};
+    struct EasyGenericObject const b_ = {.type = EASY_INTEGER_TYPE,
+                                         .data = {.integer = *b}};
+    return EasyGenericObject__equal(&a_, &b_);
+}
+
+/// @brief  Check that the result of an operation matches a decimal string,
+///         taking ownership of the result.
+static bool
+is_integer_cstr(struct EasyInteger result, char const *const expected)
+{
+    struct EasyGenericObject r = {.type = EASY_INTEGER_TYPE,
+                                  .data = {.integer = result}};
+    struct EasyGenericObject e = {
+        .type = EASY_INTEGER_TYPE,
+        .data = {.integer = EasyInteger__from_cstr(expected)}};
+    bool const ok = EasyGenericObject__equal(&r, &e);
+    if (!ok) {
+        EasyInteger__print(&result);
+        printf(" != %s\n", expected);
+    }
+    EasyGenericObject__destroy(&r);
+    EasyGenericObject__destroy(&e);
+    return ok;
+}
+
+/// @brief  Check arithmetic that carries and borrows across multiple limbs.
+bool
+test_easy_integer_limbs(void)
+{
+    struct EasyInteger a = EasyInteger__from_cstr(
+        "123456789123456789123456789123456789123456789");
+    struct EasyInteger b =
+        EasyInteger__from_cstr("-987654321987654321987654321987654321");
+    struct EasyInteger max = EasyInteger__from_cstr("18446744073709551615");
+    struct EasyInteger one = EasyInteger__from_cstr("1");
+    struct EasyInteger minus_one = EasyInteger__from_cstr("-1");
+
+    EASY_TEST_ASSERT_TRUE(is_integer_cstr(
+        EasyInteger__multiply(&a, &b),
+        "-12193263135650053159106843182563633193827160081633896958177106934"
+        "7203169112635269"));
+    EASY_TEST_ASSERT_TRUE(
+        is_integer_cstr(EasyInteger__add(&a, &b),
+                        "123456788135802467135802467135802467135802468"));
+    EASY_TEST_ASSERT_TRUE(
+        is_integer_cstr(EasyInteger__add(&b, &a),
+                        "123456788135802467135802467135802467135802468"));
+    EASY_TEST_ASSERT_TRUE(is_integer_cstr(EasyInteger__add(&max, &one),
+                                          "18446744073709551616"));
+    struct EasyInteger big = EasyInteger__add(&max, &one);
+    EASY_TEST_ASSERT_TRUE(is_integer_cstr(EasyInteger__add(&big, &minus_one),
+                                          "18446744073709551615"));
+    EASY_TEST_ASSERT_TRUE(is_integer_cstr(
+        EasyInteger__multiply(&max, &max),
+        "340282366920938463426481119284349108225"));
+    EASY_TEST_ASSERT_TRUE(
+        is_integer_cstr(EasyInteger__add(&one, &minus_one), "0"));
+
+    EasyInteger__destroy(&a);
+    EasyInteger__destroy(&b);
+    EasyInteger__destroy(&max);
+    EasyInteger__destroy(&one);
+    EasyInteger__destroy(&minus_one);
+    EasyInteger__destroy(&big);
+    return true;
+}
+
+bool
+test_easy_integer_small(void)
+{
+    struct EasyInteger max = EasyInteger__from_cstr("9223372036854775807");
+    struct EasyInteger min = EasyInteger__from_cstr("-9223372036854775808");
+    struct EasyInteger one = EasyInteger__from_cstr("1");
+    struct EasyInteger minus_one = EasyInteger__from_cstr("-1");
+    EASY_TEST_ASSERT_TRUE(max.data == NULL && min.data == NULL);
+
+    /* Overflowing the small representation falls back to limbs */
+    struct EasyInteger big = EasyInteger__add(&max, &one);
+    EASY_TEST_ASSERT_TRUE(big.data != NULL);
+    EASY_TEST_ASSERT_TRUE(is_integer_cstr(EasyInteger__copy(&big),
+                                          "9223372036854775808"));
+    EASY_TEST_ASSERT_TRUE(is_integer_cstr(EasyInteger__sub(&min, &one),
+                                          "-9223372036854775809"));
+    EASY_TEST_ASSERT_TRUE(
+        is_integer_cstr(EasyInteger__multiply(&min, &minus_one),
+                        "9223372036854775808"));
+    EASY_TEST_ASSERT_TRUE(is_integer_cstr(
+        EasyInteger__multiply(&max, &max),
+        "85070591730234615847396907784232501249"));
+    struct EasyInteger q = {0};
+    EasyInteger__divmod(&min, &minus_one, &q, NULL);
+    EASY_TEST_ASSERT_TRUE(is_integer_cstr(q, "9223372036854775808"));
+
+    /* Results that fit return to the small representation, so they hash and
+     * compare like any other small value */
+    struct EasyInteger back = EasyInteger__sub(&big, &one);
+    EASY_TEST_ASSERT_TRUE(back.data == NULL);
+    struct EasyGenericObject const a = {.type = EASY_INTEGER_TYPE,
+                                        .data = {.integer = back}};
+    struct EasyGenericObject const b = {.type = EASY_INTEGER_TYPE,
+                                        .data = {.integer = max}};
+    EASY_TEST_ASSERT_TRUE(EasyGenericObject__equal(&a, &b));
+    EASY_TEST_ASSERT_UINTCMP(EasyGenericObject__hash(&a),
+                             ==,
+                             EasyGenericObject__hash(&b));
+
+    EasyInteger__destroy(&max);
+    EasyInteger__destroy(&min);
+    EasyInteger__destroy(&one);
+    EasyInteger__destroy(&minus_one);
+    EasyInteger__destroy(&big);
+    EasyInteger__destroy(&back);
+    return true;
+}
+
+/// @brief  Create an integer with pseudo-random digits.
+static struct EasyInteger
+new_pseudorandom_integer(size_t const num_digits, uint64_t seed)
+{
+    char str[4096] = {0};
+    EASY_TEST_ASSERT_UINTCMP(num_digits + 2, <=, sizeof(str));
+    str[0] = seed % 2 ? '-' : '+';
+    for (size_t i = 1; i <= num_digits; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        str[i] = '0' + (char)((seed >> 33) % 10);
+    }
+    str[1] = str[1] == '0' ? '1' : str[1];
+    return EasyInteger__from_cstr(str);
+}
+
+/// @brief  Check that Karatsuba, Toom-3, and the NTT agree with schoolbook
+///         multiplication, including for unbalanced operands.
+bool
+test_easy_integer_multiply_tiers(void)
+{
+    size_t const lengths[] = {1, 50, 77, 200, 500, 1200, 3000};
+    size_t const num_lengths = sizeof(lengths) / sizeof(*lengths);
+    for (size_t i = 0; i < num_lengths; ++i) {
+        for (size_t j = 0; j < num_lengths; ++j) {
+            struct EasyInteger a = new_pseudorandom_integer(lengths[i], i);
+            struct EasyInteger b = new_pseudorandom_integer(lengths[j], j + 7);
+
+            EasyInteger__karatsuba_threshold = SIZE_MAX;
+            struct EasyInteger expected = EasyInteger__multiply(&a, &b);
+            EasyInteger__karatsuba_threshold = 4;
+            EasyInteger__toom3_threshold = SIZE_MAX;
+            EasyInteger__ntt_threshold = SIZE_MAX;
+            struct EasyInteger karatsuba = EasyInteger__multiply(&a, &b);
+            EasyInteger__toom3_threshold = 6;
+            struct EasyInteger toom3 = EasyInteger__multiply(&a, &b);
+            EasyInteger__ntt_threshold = 1;
+            struct EasyInteger ntt = EasyInteger__multiply(&a, &b);
+
+            EASY_TEST_ASSERT_TRUE(is_same_integer(&karatsuba, &expected));
+            EASY_TEST_ASSERT_TRUE(is_same_integer(&toom3, &expected));
+            EASY_TEST_ASSERT_TRUE(is_same_integer(&ntt, &expected));
+            EasyInteger__destroy(&a);
+            EasyInteger__destroy(&b);
+            EasyInteger__destroy(&expected);
+            EasyInteger__destroy(&karatsuba);
+            EasyInteger__destroy(&toom3);
+            EasyInteger__destroy(&ntt);
+        }
+    }
+    EasyInteger__karatsuba_threshold = EASY_INTEGER_KARATSUBA_THRESHOLD;
+    EasyInteger__toom3_threshold = EASY_INTEGER_TOOM3_THRESHOLD;
+    EasyInteger__ntt_threshold = EASY_INTEGER_NTT_THRESHOLD;
+    return true;
+}
+
+/// @brief  Check that large integers survive a trip through decimal, which
+///         takes the divide-and-conquer path.
+bool
+test_easy_integer_decimal(void)
+{
+    static char digits[20001] = {0};
+    static char buffer[20002] = {0};
+    uint64_t seed = 12345;
+    digits[0] = '-';
+    for (size_t i = 1; i < sizeof(digits) - 1; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        digits[i] = '0' + (char)((seed >> 33) % 10);
+    }
+    digits[1] = '7';
+    /* Runs of zeros must survive the padding between the halves */
+    memset(&digits[5000], '0', 3000);
+
+    struct EasyInteger a = EasyInteger__from_cstr(digits);
+    size_t const length = EasyInteger__to_cstr(&a, buffer, sizeof(buffer));
+    EASY_TEST_ASSERT_UINTCMP(length, ==, strlen(digits));
+    EASY_TEST_ASSERT_TRUE(strcmp(buffer, digits) == 0);
+
+    /* We truncate like snprintf */
+    char small[8] = {0};
+    EASY_TEST_ASSERT_UINTCMP(
+        EasyInteger__to_cstr(&a, small, sizeof(small)), ==, length);
+    EASY_TEST_ASSERT_TRUE(strncmp(small, digits, 7) == 0 && small[7] == '\0');
+
+    struct EasyInteger zero = EasyInteger__from_cstr("0");
+    EASY_TEST_ASSERT_UINTCMP(EasyInteger__to_cstr(&zero, small, 8), ==, 1);
+    EASY_TEST_ASSERT_TRUE(strcmp(small, "0") == 0);
+
+    EasyInteger__destroy(&a);
+    EasyInteger__destroy(&zero);
+    return true;
+}
+
+bool
+test_easy_integer_division(void)
+{
+    /* We round towards negative infinity */
+    char const *const signs[][4] = {{"7", "-2", "-4", "-1"},
+                                    {"-7", "2", "-4", "1"},
+                                    {"-7", "-2", "3", "-1"},
+                                    {"6", "-3", "-2", "0"}};
+    for (size_t i = 0; i < sizeof(signs) / sizeof(*signs); ++i) {
+        struct EasyInteger a = EasyInteger__from_cstr(signs[i][0]);
+        struct EasyInteger b = EasyInteger__from_cstr(signs[i][1]);
+        struct EasyInteger q = {0}, r = {0};
+        EasyInteger__divmod(&a, &b, &q, &r);
+        EASY_TEST_ASSERT_TRUE(is_integer_cstr(q, signs[i][2]));
+        EASY_TEST_ASSERT_TRUE(is_integer_cstr(r, signs[i][3]));
+        EasyInteger__destroy(&a);
+        EasyInteger__destroy(&b);
+    }
+
+    /* Knuth's Algorithm D and Newton's reciprocal must agree, and
+     * a = q * b + r where r lies between zero and b */
+    size_t const lengths[] = {1, 30, 100, 400, 2500};
+    size_t const num_lengths = sizeof(lengths) / sizeof(*lengths);
+    for (size_t i = 0; i < num_lengths; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            struct EasyInteger a = new_pseudorandom_integer(lengths[i], i);
+            struct EasyInteger b = new_pseudorandom_integer(lengths[j], j + 3);
+            struct EasyInteger q = {0}, r = {0}, newton_q = {0}, newton_r = {0};
+            EasyInteger__newton_division_threshold = SIZE_MAX;
+            EasyInteger__divmod(&a, &b, &q, &r);
+            EasyInteger__newton_division_threshold = 2;
+            EasyInteger__divmod(&a, &b, &newton_q, &newton_r);
+            EASY_TEST_ASSERT_TRUE(is_same_integer(&q, &newton_q));
+            EASY_TEST_ASSERT_TRUE(is_same_integer(&r, &newton_r));
+            EASY_TEST_ASSERT_TRUE(r.sign != -b.sign &&
+                                  b.sign * EasyInteger__compare(&r, &b) < 0);
+            struct EasyInteger qb = EasyInteger__multiply(&q, &b);
+            struct EasyInteger a_ = EasyInteger__add(&qb, &r);
+            EASY_TEST_ASSERT_TRUE(is_same_integer(&a_, &a));
+            EasyInteger__destroy(&a);
+            EasyInteger__destroy(&b);
+            EasyInteger__destroy(&q);
+            EasyInteger__destroy(&r);
+            EasyInteger__destroy(&newton_q);
+            EasyInteger__destroy(&newton_r);
+            EasyInteger__destroy(&qb);
+            EasyInteger__destroy(&a_);
+        }
+    }
+    EasyInteger__newton_division_threshold =
+        EASY_INTEGER_NEWTON_DIVISION_THRESHOLD;
+
+    struct EasyInteger two = EasyInteger__from_cstr("2");
+    struct EasyInteger e = EasyInteger__from_cstr("200");
+    EASY_TEST_ASSERT_TRUE(is_integer_cstr(
+        EasyInteger__pow(&two, &e),
+        "1606938044258990275541962092341162602522202993782792835301376"));
+    struct EasyInteger base = EasyInteger__from_cstr("-5");
+    struct EasyInteger exponent =
+        EasyInteger__from_cstr("12345678901234567890");
+    struct EasyInteger modulus =
+        EasyInteger__from_cstr("170141183460469231731687303715884105727");
+    EASY_TEST_ASSERT_TRUE(
+        is_integer_cstr(EasyInteger__modpow(&base, &exponent, &modulus),
+                        "167890981565005282584091622339884095143"));
+    struct EasyInteger x = EasyInteger__from_cstr(
+        "55340232221128654848"
+        "0000000000000000000000000000000000000000000000000000000000000");
+    struct EasyInteger y = EasyInteger__from_cstr("-600");
+    EASY_TEST_ASSERT_TRUE(is_integer_cstr(EasyInteger__gcd(&x, &y), "600"));
+    EASY_TEST_ASSERT_TRUE(EasyInteger__compare(&y, &two) < 0);
+    EASY_TEST_ASSERT_TRUE(EasyInteger__compare(&x, &x) == 0);
+    EASY_TEST_ASSERT_TRUE(
+        is_integer_cstr(EasyInteger__sub(&two, &e), "-198"));
+    EasyInteger__destroy(&two);
+    EasyInteger__destroy(&e);
+    EasyInteger__destroy(&base);
+    EasyInteger__destroy(&exponent);
+    EasyInteger__destroy(&modulus);
+    EasyInteger__destroy(&x);
+    EasyInteger__destroy(&y);
+    return true;
+}
+
 bool
 test_easy_text(void)
 {
@@ -157,6 +463,101 @@ test_easy_text(void)
     return true;
 }
 
+/// @brief  Check that copies share the buffer and outlive the original.
+bool
+test_easy_text_sharing(void)
+{
+    char const *const long_str = "Hello, World! Hello, World! Hello, World!";
+    struct EasyText a = EasyText__from_cstr(long_str);
+    struct EasyText b = EasyText__copy(&a);
+    EASY_TEST_ASSERT_TRUE(a.data != NULL && a.data == b.data);
+
+    EasyText__destroy(&a);
+    EASY_TEST_ASSERT_TRUE(strcmp(EasyText__get_data(&b), long_str) == 0);
+    EASY_TEST_ASSERT_UINTCMP(b.length, ==, strlen(long_str));
+    EasyText__destroy(&b);
+
+    /* Short texts live inline, so copies are independent */
+    struct EasyText c = EasyText__from_cstr("Hello, World!");
+    struct EasyText d = EasyText__copy(&c);
+    EASY_TEST_ASSERT_TRUE(c.data == NULL && d.data == NULL);
+    EasyText__destroy(&c);
+    EASY_TEST_ASSERT_TRUE(strcmp(EasyText__get_data(&d), "Hello, World!") == 0);
+
+    /* Both representations compare and hash by their characters */
+    char buffer[EASY_TEXT_SMALL_CAPACITY + 2] = {0};
+    for (size_t i = EASY_TEXT_SMALL_CAPACITY; i <= EASY_TEXT_SMALL_CAPACITY + 1;
+         ++i) {
+        memset(buffer, 'x', i);
+        struct EasyGenericObject x = {
+            .type = EASY_TEXT_TYPE,
+            .data = {.text = EasyText__from_cstr(buffer)}};
+        struct EasyGenericObject y = {
+            .type = EASY_TEXT_TYPE,
+            .data = {.text = EasyText__from_cstr(buffer)}};
+        EASY_TEST_ASSERT_TRUE((x.data.text.data == NULL) ==
+                              (i <= EASY_TEXT_SMALL_CAPACITY));
+        EASY_TEST_ASSERT_TRUE(EasyGenericObject__equal(&x, &y));
+        EASY_TEST_ASSERT_UINTCMP(EasyGenericObject__hash(&x),
+                                 ==,
+                                 EasyGenericObject__hash(&y));
+        EasyGenericObject__destroy(&x);
+        EasyGenericObject__destroy(&y);
+    }
+    EasyText__destroy(&d);
+    return true;
+}
+
+bool
+test_easy_text_intern(void)
+{
+    struct EasyArena *arena = EasyArena__new();
+    struct EasyArena *previous = EasyArena__enter(arena);
+    struct EasyText a = EasyText__intern("key");
+    EasyArena__exit(previous);
+    struct EasyText b = EasyText__intern("key");
+    struct EasyText c = EasyText__intern("another key");
+    /* The pool keeps its texts out of any arena that we happen to be in */
+    EASY_TEST_ASSERT_TRUE(a.data != NULL && EasyArena__owner(a.data) == NULL);
+    EasyArena__destroy(arena);
+    EASY_TEST_ASSERT_TRUE(a.data == b.data && a.data != c.data);
+
+    /* The interned texts carry the hash that a fresh text would compute */
+    struct EasyGenericObject x = {.type = EASY_TEXT_TYPE, .data = {.text = b}};
+    struct EasyGenericObject y = {
+        .type = EASY_TEXT_TYPE,
+        .data = {.text = EasyText__from_cstr("key")}};
+    EASY_TEST_ASSERT_UINTCMP(b.hash, !=, 0);
+    EASY_TEST_ASSERT_UINTCMP(EasyGenericObject__hash(&x),
+                             ==,
+                             EasyGenericObject__hash(&y));
+    EASY_TEST_ASSERT_UINTCMP(x.data.text.hash, ==, y.data.text.hash);
+    EASY_TEST_ASSERT_TRUE(EasyGenericObject__equal(&x, &y));
+    EasyGenericObject__destroy(&y);
+
+    /* Clearing the pool leaves our copies intact, but interns anew */
+    EasyText__clear_interned();
+    EASY_TEST_ASSERT_TRUE(strcmp(EasyText__get_data(&a), "key") == 0);
+    struct EasyText d = EasyText__intern("key");
+    EASY_TEST_ASSERT_TRUE(d.data != a.data);
+    EasyText__destroy(&a);
+    EasyText__destroy(&b);
+    EasyText__destroy(&c);
+    EasyText__destroy(&d);
+    EasyText__clear_interned();
+    return true;
+}
+
+static struct EasyGenericObject
+new_integer_object(size_t const value)
+{
+    char buffer[32] = {0};
+    snprintf(buffer, sizeof(buffer), "%zu", value);
+    return (struct EasyGenericObject){
+        .type = EASY_INTEGER_TYPE,
+        .data = {.integer = EasyInteger__from_cstr(buffer)}};
+}
+
 bool
 test_easy_list(void)
 {
@@ -210,6 +611,61 @@ test_easy_list(void)
     return true;
 }
 
+static bool
+is_integer_element(struct EasyList const *const list,
+                   size_t const index,
+                   size_t const value)
+{
+    struct EasyGenericObject expected = new_integer_object(value);
+    bool const ok =
+        EasyGenericObject__equal(EasyList__get(list, index), &expected);
+    EasyGenericObject__destroy(&expected);
+    return ok;
+}
+
+/// @brief  Check that removing, slicing, and concatenating leave the older
+///         versions intact.
+bool
+test_easy_list_persistence(void)
+{
+    size_t const num_elements = 3000;
+    struct EasyList a = EasyList__new_empty();
+    for (size_t i = 0; i < num_elements; ++i) {
+        struct EasyGenericObject x = new_integer_object(i);
+        struct EasyList new_a = EasyList__append(&a, &x);
+        EasyList__destroy(&a);
+        a = new_a;
+        EasyGenericObject__destroy(&x);
+    }
+    EASY_TEST_ASSERT_UINTCMP(a.length, ==, num_elements);
+
+    struct EasyList b = EasyList__remove(&a, 1234);
+    struct EasyList c = EasyList__slice(&a, 100, 2100);
+    struct EasyList d = EasyList__concat(&c, &a);
+
+    EASY_TEST_ASSERT_UINTCMP(b.length, ==, num_elements - 1);
+    EASY_TEST_ASSERT_UINTCMP(c.length, ==, 2000);
+    EASY_TEST_ASSERT_UINTCMP(d.length, ==, 2000 + num_elements);
+    for (size_t i = 0; i < num_elements; ++i) {
+        EASY_TEST_ASSERT_TRUE(is_integer_element(&a, i, i));
+        EASY_TEST_ASSERT_TRUE(is_integer_element(&d, 2000 + i, i));
+        if (i < num_elements - 1) {
+            EASY_TEST_ASSERT_TRUE(
+                is_integer_element(&b, i, i < 1234 ? i : i + 1));
+        }
+        if (i < 2000) {
+            EASY_TEST_ASSERT_TRUE(is_integer_element(&c, i, 100 + i));
+            EASY_TEST_ASSERT_TRUE(is_integer_element(&d, i, 100 + i));
+        }
+    }
+
+    EasyList__destroy(&a);
+    EasyList__destroy(&b);
+    EasyList__destroy(&c);
+    EasyList__destroy(&d);
+    return true;
+}
+
 bool
 test_easy_table(void)
 {
@@ -304,6 +760,377 @@ test_easy_table(void)
     return true;
 }
 
+/// @brief  Count the nodes in a subtrie of an EasyTable.
+static size_t
+count_table_nodes(struct EasyTableNode const *const node)
+{
+    size_t count = 1;
+    for (size_t i = 0; i < node->num_nodes; ++i) {
+        count += count_table_nodes(node->slots[node->num_items + i].node);
+    }
+    return count;
+}
+
+/// @brief  Check that "modifying" a table leaves the older versions intact.
+bool
+test_easy_table_persistence(void)
+{
+    size_t const num_keys = 2000;
+    struct EasyTable table = EasyTable__new_empty();
+    struct EasyTable snapshot = EasyTable__new_empty();
+
+    for (size_t i = 0; i < num_keys; ++i) {
+        struct EasyGenericObject key = new_integer_object(i);
+        struct EasyGenericObject value = new_integer_object(2 * i);
+        struct EasyTable new_table = EasyTable__insert(&table, &key, &value);
+        EasyTable__destroy(&table);
+        table = new_table;
+        if (i + 1 == num_keys / 2) {
+            snapshot = EasyTable__copy(&table);
+        }
+        EasyGenericObject__destroy(&key);
+        EasyGenericObject__destroy(&value);
+    }
+    EASY_TEST_ASSERT_UINTCMP(table.length, ==, num_keys);
+    EASY_TEST_ASSERT_UINTCMP(snapshot.length, ==, num_keys / 2);
+
+    /* Remove every key from the newest version */
+    for (size_t i = num_keys; i-- > 0;) {
+        struct EasyGenericObject key = new_integer_object(i);
+        struct EasyGenericObject expected = new_integer_object(2 * i);
+        struct EasyGenericObject value = EasyTable__lookup(&table, &key);
+        EASY_TEST_ASSERT_TRUE(EasyGenericObject__equal(&value, &expected));
+
+        struct EasyTable new_table = EasyTable__remove(&table, &key);
+        EasyTable__destroy(&table);
+        table = new_table;
+        /* Removing the second half should shrink the trie to the shape that
+         * it had before we inserted them */
+        if (i == num_keys / 2) {
+            EASY_TEST_ASSERT_UINTCMP(count_table_nodes(table.root),
+                                     ==,
+                                     count_table_nodes(snapshot.root));
+        }
+        EasyGenericObject__destroy(&key);
+        EasyGenericObject__destroy(&expected);
+        EasyGenericObject__destroy(&value);
+    }
+    EASY_TEST_ASSERT_UINTCMP(table.length, ==, 0);
+    EASY_TEST_ASSERT_TRUE(table.root == NULL);
+
+    /* The snapshot should still hold exactly the first half of the keys */
+    for (size_t i = 0; i < num_keys; ++i) {
+        struct EasyGenericObject key = new_integer_object(i);
+        struct EasyGenericObject value = EasyTable__lookup(&snapshot, &key);
+        if (i < num_keys / 2) {
+            struct EasyGenericObject expected = new_integer_object(2 * i);
+            EASY_TEST_ASSERT_TRUE(EasyGenericObject__equal(&value, &expected));
+            EasyGenericObject__destroy(&expected);
+        } else {
+            EASY_TEST_ASSERT_TRUE(value.type == EASY_NOTHING_TYPE);
+        }
+        EasyGenericObject__destroy(&key);
+        EasyGenericObject__destroy(&value);
+    }
+
+    EasyTable__destroy(&table);
+    EasyTable__destroy(&snapshot);
+    return true;
+}
+
+/// @brief  Check that the builders produce regular, persistent collections.
+bool
+test_easy_builders(void)
+{
+    size_t const num_elements = 40000;
+    struct EasyListBuilder list_builder = EasyListBuilder__new_empty();
+    struct EasyTableBuilder table_builder = EasyTableBuilder__new_empty();
+    for (size_t i = 0; i < num_elements; ++i) {
+        struct EasyGenericObject x = new_integer_object(i);
+        struct EasyGenericObject y = new_integer_object(i % 1000);
+        EasyListBuilder__append(&list_builder, &x);
+        /* The later values overwrite the earlier ones */
+        EasyTableBuilder__insert(&table_builder, &y, &x);
+        EasyGenericObject__destroy(&x);
+        EasyGenericObject__destroy(&y);
+    }
+    struct EasyList list = EasyListBuilder__freeze(&list_builder);
+    struct EasyTable table = EasyTableBuilder__freeze(&table_builder);
+    EASY_TEST_ASSERT_UINTCMP(list_builder.length, ==, 0);
+    EASY_TEST_ASSERT_UINTCMP(table_builder.length, ==, 0);
+    EASY_TEST_ASSERT_UINTCMP(list.length, ==, num_elements);
+    EASY_TEST_ASSERT_UINTCMP(table.length, ==, 1000);
+
+    struct EasyGenericObject x = new_integer_object(num_elements);
+    struct EasyList longer = EasyList__append(&list, &x);
+    struct EasyList shorter = EasyList__remove(&list, 0);
+    struct EasyTable bigger = EasyTable__insert(&table, &x, &x);
+    EASY_TEST_ASSERT_UINTCMP(longer.length, ==, num_elements + 1);
+    EASY_TEST_ASSERT_UINTCMP(shorter.length, ==, num_elements - 1);
+    EASY_TEST_ASSERT_UINTCMP(bigger.length, ==, 1001);
+    /* Replacing a value keeps the key's place in the insertion order */
+    EASY_TEST_ASSERT_UINTCMP(table.next_order, ==, 1000);
+    EASY_TEST_ASSERT_UINTCMP(bigger.next_order, ==, 1001);
+    EASY_TEST_ASSERT_TRUE(
+        is_integer_element(&longer, num_elements, num_elements));
+    for (size_t i = 0; i < num_elements; ++i) {
+        EASY_TEST_ASSERT_TRUE(is_integer_element(&list, i, i));
+        EASY_TEST_ASSERT_TRUE(is_integer_element(&longer, i, i));
+        if (i + 1 < num_elements) {
+            EASY_TEST_ASSERT_TRUE(is_integer_element(&shorter, i, i + 1));
+        }
+    }
+    struct EasyTable expected_table = EasyTable__new_empty();
+    for (size_t i = 0; i < 1000; ++i) {
+        struct EasyGenericObject key = new_integer_object(i);
+        struct EasyGenericObject expected =
+            new_integer_object(num_elements - 1000 + i);
+        struct EasyGenericObject value = EasyTable__lookup(&table, &key);
+        EASY_TEST_ASSERT_TRUE(EasyGenericObject__equal(&value, &expected));
+        struct EasyTable next =
+            EasyTable__insert(&expected_table, &key, &value);
+        EasyTable__destroy(&expected_table);
+        expected_table = next;
+        EasyGenericObject__destroy(&key);
+        EasyGenericObject__destroy(&expected);
+        EasyGenericObject__destroy(&value);
+    }
+    /* The builder replaced values along the way, so this checks that it kept
+     * the running hash up to date */
+    EASY_TEST_ASSERT_UINTCMP(table.hash_sum, ==, expected_table.hash_sum);
+    EasyTable__destroy(&expected_table);
+
+    /* Destroying an unfrozen builder should release everything */
+    EasyListBuilder__append(&list_builder, &x);
+    EasyTableBuilder__insert(&table_builder, &x, &x);
+    EasyListBuilder__destroy(&list_builder);
+    EasyTableBuilder__destroy(&table_builder);
+
+    EasyGenericObject__destroy(&x);
+    EasyList__destroy(&list);
+    EasyList__destroy(&longer);
+    EasyList__destroy(&shorter);
+    EasyTable__destroy(&table);
+    EasyTable__destroy(&bigger);
+    return true;
+}
+
+/// @brief  Build a long text (which needs a buffer) on another thread.
+static void *
+new_text_on_thread(void *const arg)
+{
+    struct EasyText *const text = arg;
+    EASY_ASSERT(EasyArena__current() == NULL, "threads enter arenas alone");
+    *text = EasyText__from_cstr("Hello from another thread, World!");
+    return NULL;
+}
+
+/// @brief  Check that objects built within an arena's scope live in the arena.
+bool
+test_easy_arena(void)
+{
+    size_t const num_keys = 1000;
+    /* This lives on the heap, even though we destroy it in the arena's scope */
+    struct EasyText outside = EasyText__from_cstr("Good-bye, World!");
+
+    struct EasyArena *arena = EasyArena__new();
+    struct EasyArena *previous = EasyArena__enter(arena);
+    struct EasyTableBuilder builder = EasyTableBuilder__new_empty();
+    for (size_t i = 0; i < num_keys; ++i) {
+        struct EasyGenericObject key = new_integer_object(i);
+        struct EasyGenericObject value = new_integer_object(2 * i);
+        EasyTableBuilder__insert(&builder, &key, &value);
+        EasyGenericObject__destroy(&key);
+        EasyGenericObject__destroy(&value);
+    }
+    struct EasyTable table = EasyTableBuilder__freeze(&builder);
+    /* Short texts live inline, so we need a long one to fill a buffer */
+    struct EasyText text =
+        EasyText__from_cstr("Hello, World! Hello, World! Hello, World!");
+    EasyText__destroy(&outside);
+    EasyArena__exit(previous);
+
+    EASY_TEST_ASSERT_TRUE(EasyArena__current() == previous);
+    EASY_TEST_ASSERT_TRUE(EasyArena__owner(table.root) == arena);
+    EASY_TEST_ASSERT_TRUE(EasyArena__owner(text.data) == arena);
+    /* Entering an arena on one thread leaves the other threads on the heap */
+    struct EasyArena *const scoped = EasyArena__new();
+    EasyArena__enter(scoped);
+    struct EasyText threaded = {0};
+    pthread_t thread;
+    EASY_TEST_ASSERT_TRUE(
+        pthread_create(&thread, NULL, new_text_on_thread, &threaded) == 0);
+    EASY_TEST_ASSERT_TRUE(pthread_join(thread, NULL) == 0);
+    EasyArena__exit(previous);
+    EASY_TEST_ASSERT_TRUE(threaded.data != NULL);
+    EASY_TEST_ASSERT_TRUE(EasyArena__owner(threaded.data) == NULL);
+    EasyText__destroy(&threaded);
+    EasyArena__destroy(scoped);
+
+    struct EasyText after =
+        EasyText__from_cstr("Good-bye, World! Good-bye, World!");
+    EASY_TEST_ASSERT_TRUE(after.data != NULL);
+    EASY_TEST_ASSERT_TRUE(EasyArena__owner(after.data) == NULL);
+    EasyText__destroy(&after);
+    EASY_TEST_ASSERT_UINTCMP(table.length, ==, num_keys);
+    for (size_t i = 0; i < num_keys; i += 37) {
+        struct EasyGenericObject key = new_integer_object(i);
+        struct EasyGenericObject expected = new_integer_object(2 * i);
+        struct EasyGenericObject value = EasyTable__lookup(&table, &key);
+        EASY_TEST_ASSERT_TRUE(EasyGenericObject__equal(&value, &expected));
+        EasyGenericObject__destroy(&key);
+        EasyGenericObject__destroy(&expected);
+        EasyGenericObject__destroy(&value);
+    }
+
+    /* Destroying an object in the arena is safe, but we need not bother */
+    EasyText__destroy(&text);
+    EasyArena__destroy(arena);
+
+    /* Converting a big integer caches powers of ten for good, so the cache
+     * must survive the arena that we first convert in. We use more digits
+     * than the other tests so that we fill new levels of the cache here. */
+    static char digits[80001] = {0};
+    static char before[sizeof(digits)] = {0};
+    static char after_arena[sizeof(digits)] = {0};
+    memset(digits, '9', sizeof(digits) - 1);
+    arena = EasyArena__new();
+    previous = EasyArena__enter(arena);
+    struct EasyInteger big = EasyInteger__from_cstr(digits);
+    EasyInteger__to_cstr(&big, before, sizeof(before));
+    EasyArena__exit(previous);
+    EasyArena__destroy(arena);
+    big = EasyInteger__from_cstr(digits);
+    EasyInteger__to_cstr(&big, after_arena, sizeof(after_arena));
+    EasyInteger__destroy(&big);
+    EASY_TEST_ASSERT_TRUE(strcmp(before, digits) == 0);
+    EASY_TEST_ASSERT_TRUE(strcmp(after_arena, digits) == 0);
+    return true;
+}
+
+#ifndef EASY_POOL_DISABLE
+/// @brief  Allocate a small chunk on a thread, reporting its address.
+static void *
+use_chunk_on_thread(void *const arg)
+{
+    void **const chunk = arg;
+    *chunk = EASY_MALLOC(40, 1);
+    return NULL;
+}
+
+/// @brief  Allocate a small chunk on a thread and free it before we exit.
+static void *
+free_chunk_on_thread(void *const arg)
+{
+    void **const chunk = arg;
+    *chunk = EASY_MALLOC(40, 1);
+    EASY_FREE(*chunk);
+    return NULL;
+}
+#endif
+
+/// @brief  Check that recycled and resized allocations behave like malloc's.
+bool
+test_easy_pool(void)
+{
+    size_t const sizes[] = {1, 16, 17, 100, 256, 257, 4096};
+    size_t const num_sizes = sizeof(sizes) / sizeof(*sizes);
+    for (size_t i = 0; i < num_sizes; ++i) {
+        /* Dirty a chunk and free it, so the next one of this size reuses it */
+        unsigned char *dirty = EASY_MALLOC(sizes[i], 1);
+        memset(dirty, 0xFF, sizes[i]);
+        EASY_FREE(dirty);
+        unsigned char *clean = EASY_MALLOC(sizes[i], 1);
+        for (size_t j = 0; j < sizes[i]; ++j) {
+            EASY_TEST_ASSERT_UINTCMP(clean[j], ==, 0);
+        }
+        EASY_FREE(clean);
+    }
+
+    /* Grow an allocation through every size, then shrink it back */
+    unsigned char *data = EASY_MALLOC(1, 1);
+    data[0] = 42;
+    for (size_t i = 1; i < num_sizes; ++i) {
+        data = EASY_REALLOC(data, sizes[i], 1);
+        memset(data + sizes[i - 1], (int)i, sizes[i] - sizes[i - 1]);
+    }
+    for (size_t i = num_sizes - 1; i-- > 0;) {
+        data = EASY_REALLOC(data, sizes[i], 1);
+        for (size_t j = 1; j < num_sizes && sizes[j] <= sizes[i]; ++j) {
+            EASY_TEST_ASSERT_UINTCMP(data[sizes[j] - 1], ==, j);
+        }
+    }
+    EASY_TEST_ASSERT_UINTCMP(data[0], ==, 42);
+    EASY_FREE(data);
+
+#ifndef EASY_POOL_DISABLE
+    /* A thread's chunks outlive it, so the next thread reuses them */
+    void *freed = NULL, *reused = NULL;
+    pthread_t thread;
+    EASY_TEST_ASSERT_TRUE(
+        pthread_create(&thread, NULL, free_chunk_on_thread, &freed) == 0);
+    EASY_TEST_ASSERT_TRUE(pthread_join(thread, NULL) == 0);
+    EASY_TEST_ASSERT_TRUE(
+        pthread_create(&thread, NULL, use_chunk_on_thread, &reused) == 0);
+    EASY_TEST_ASSERT_TRUE(pthread_join(thread, NULL) == 0);
+    EASY_TEST_ASSERT_TRUE(freed == reused);
+    EASY_FREE(reused);
+#endif
+    return true;
+}
+
+/// @brief  Check that the telemetry accounts for every byte (if we enabled
+///         it) or records nothing (if we did not).
+/// @brief  Allocate and free many small chunks on a thread.
+static void *
+churn_on_thread(void *const arg)
+{
+    (void)arg;
+    for (size_t i = 0; i < 1000; ++i) {
+        EASY_FREE(EASY_MALLOC(16, 1));
+    }
+    return NULL;
+}
+
+bool
+test_easy_telemetry(void)
+{
+    struct EasyTelemetryStats const before = EasyTelemetry__get_stats();
+    char *data = EASY_MALLOC(100, 1);
+    data = EASY_REALLOC(data, 1000, 1);
+    struct EasyTelemetryStats const during = EasyTelemetry__get_stats();
+    EASY_FREE(data);
+    struct EasyTelemetryStats const after = EasyTelemetry__get_stats();
+
+    size_t const expected = EasyTelemetry__is_enabled() ? 1000 : 0;
+    EASY_TEST_ASSERT_UINTCMP(during.live_bytes - before.live_bytes,
+                             ==,
+                             expected);
+    EASY_TEST_ASSERT_UINTCMP(during.num_bytes - before.num_bytes,
+                             ==,
+                             expected == 0 ? 0 : 1100);
+    EASY_TEST_ASSERT_UINTCMP(during.peak_live_bytes, >=, during.live_bytes);
+    EASY_TEST_ASSERT_UINTCMP(after.live_bytes, ==, before.live_bytes);
+    EASY_TEST_ASSERT_UINTCMP(after.live_allocs, ==, before.live_allocs);
+
+    /* Threads record into the same counters without losing any updates */
+    pthread_t threads[4];
+    size_t const num_threads = sizeof(threads) / sizeof(*threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        EASY_TEST_ASSERT_TRUE(
+            pthread_create(&threads[i], NULL, churn_on_thread, NULL) == 0);
+    }
+    for (size_t i = 0; i < num_threads; ++i) {
+        EASY_TEST_ASSERT_TRUE(pthread_join(threads[i], NULL) == 0);
+    }
+    struct EasyTelemetryStats const joined = EasyTelemetry__get_stats();
+    EASY_TEST_ASSERT_UINTCMP(joined.num_allocs - after.num_allocs,
+                             ==,
+                             expected == 0 ? 0 : num_threads * 1000);
+    EASY_TEST_ASSERT_UINTCMP(joined.live_allocs, ==, before.live_allocs);
+    return true;
+}
+
 bool
 test_easy_error(void)
 {
@@ -343,9 +1170,22 @@ main(void)
     // Test types
     EASY_TEST_SUCCESS(test_easy_boolean());
     EASY_TEST_SUCCESS(test_easy_integer());
+    EASY_TEST_SUCCESS(test_easy_integer_limbs());
+    EASY_TEST_SUCCESS(test_easy_integer_small());
+    EASY_TEST_SUCCESS(test_easy_integer_multiply_tiers());
+    EASY_TEST_SUCCESS(test_easy_integer_decimal());
+    EASY_TEST_SUCCESS(test_easy_integer_division());
     EASY_TEST_SUCCESS(test_easy_text());
+    EASY_TEST_SUCCESS(test_easy_text_sharing());
+    EASY_TEST_SUCCESS(test_easy_text_intern());
     EASY_TEST_SUCCESS(test_easy_list());
+    EASY_TEST_SUCCESS(test_easy_list_persistence());
     EASY_TEST_SUCCESS(test_easy_table());
+    EASY_TEST_SUCCESS(test_easy_table_persistence());
+    EASY_TEST_SUCCESS(test_easy_builders());
+    EASY_TEST_SUCCESS(test_easy_arena());
+    EASY_TEST_SUCCESS(test_easy_pool());
+    EASY_TEST_SUCCESS(test_easy_telemetry());
 
     // Test Sort-of-Types
     EASY_TEST_SUCCESS(test_easy_error());